@@ -7,6 +7,17 @@
 #include <string.h>
 #include "queue.h"
 
+// Com NDEBUG (compilação de produção), queue_append e queue_remove executam em
+// tempo constante: não percorrem a fila para verificar se o elemento já está
+// nela (-8) ou se pertence a ela (-6, -7). As demais verificações continuam.
+#ifndef QUEUE_CHECKED
+#ifdef NDEBUG
+#define QUEUE_CHECKED 0
+#else
+#define QUEUE_CHECKED 1
+#endif
+#endif
+
 int queue_size (queue_t *queue)
 {
     if (queue == NULL) {
@@ -92,6 +103,7 @@ int queue_append (queue_t **queue, queue_t *elem)
         return 0;
     }
 
+#if QUEUE_CHECKED
     // Verifica se o elemento já está na fila
     queue_t *aux = (*queue);
     do {
@@ -101,6 +113,7 @@ int queue_append (queue_t **queue, queue_t *elem)
         }
         aux = aux->next;
     } while (aux != (*queue));
+#endif
 
     queue_t *last = (*queue)->prev;
     last->next = elem;
@@ -156,6 +169,16 @@ int queue_remove (queue_t **queue, queue_t *elem)
         return 0;
     }
 
+#if !QUEUE_CHECKED
+    // O elemento está em uma fila e confia-se que seja esta
+    elem->next->prev = elem->prev;
+    elem->prev->next = elem->next;
+
+    elem->next = NULL;
+    elem->prev = NULL;
+
+    return 0;
+#else
     queue_t *aux = (*queue)->next;
     while (aux != (*queue))
     {
@@ -179,5 +202,6 @@ int queue_remove (queue_t **queue, queue_t *elem)
 
     fprintf(stderr, "ERRO: Elemento a ser removido não está na fila!\n");
     return -6;
+#endif
 }
 
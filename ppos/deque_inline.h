@@ -0,0 +1,184 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Deque de ponteiros em um vetor circular que cresce sob demanda, inteiramente
+// em linha. Alternativa a queue_inline.h quando a fila é longa: percorrer o
+// vetor não segue um ponteiro por elemento.
+//
+// Cada elemento guarda no campo "pos" (unsigned int) sua posição absoluta no
+// deque; a posição i fica em slot[i & (size - 1)]. Inserir e retirar nas pontas
+// é O(1). Retirar do meio deixa uma lápide (NULL) no vetor; as lápides das
+// pontas são descartadas na hora e as do meio são eliminadas por uma compactação
+// quando passam da metade do trecho ocupado (custo amortizado O(1)).
+//
+// DEQUE_TYPE (taskdq, struct task_t)            // declara taskdq_t
+// DEQUE_INLINE (taskdq, task_t, ready_pos)      // gera taskdq_push_back, ...
+//
+// Um deque zerado é um deque vazio válido.
+
+#ifndef __DEQUE_INLINE__
+#define __DEQUE_INLINE__
+
+#include <stdlib.h>
+
+#define DEQUE_MIN_SIZE 16                         // capacidade inicial do vetor
+
+#define DEQUE_TYPE(name, type)                                                 \
+typedef struct                                                                 \
+{                                                                              \
+   type **slot ;                  /* vetor circular, "size" posições */        \
+   unsigned int size ;            /* capacidade, potência de 2 (0: sem vetor) */\
+   unsigned int head, tail ;      /* posições absolutas [head, tail) ocupadas */\
+   unsigned int dead ;            /* lápides entre head e tail */              \
+} name##_t ;
+
+#define DEQUE_INLINE(name, type, pos)                                          \
+                                                                               \
+/* Quantidade de elementos no deque */                                         \
+static inline unsigned int name##_count (name##_t *dq)                         \
+{                                                                              \
+    return dq->tail - dq->head - dq->dead ;                                    \
+}                                                                              \
+                                                                               \
+/* Primeiro e último elementos, ou NULL se o deque está vazio */               \
+static inline type *name##_first (name##_t *dq)                                \
+{                                                                              \
+    return (dq->head != dq->tail) ? dq->slot[dq->head & (dq->size - 1)] : NULL ;\
+}                                                                              \
+                                                                               \
+static inline type *name##_last (name##_t *dq)                                 \
+{                                                                              \
+    return (dq->head != dq->tail) ? dq->slot[(dq->tail - 1) & (dq->size - 1)] : NULL ;\
+}                                                                              \
+                                                                               \
+/* Regrava os elementos vivos de forma contígua a partir de head */            \
+static inline void name##_compact (name##_t *dq)                               \
+{                                                                              \
+    unsigned int mask = dq->size - 1, from, to = dq->head ;                    \
+    type *elem ;                                                               \
+                                                                               \
+    for (from = dq->head; from != dq->tail; from++)                            \
+        if ((elem = dq->slot[from & mask]))                                    \
+        {                                                                      \
+            elem->pos = to ;                                                   \
+            dq->slot[to++ & mask] = elem ;                                     \
+        }                                                                      \
+    dq->tail = to ;                                                            \
+    dq->dead = 0 ;                                                             \
+}                                                                              \
+                                                                               \
+/* Garante espaço para mais um elemento; -1 se faltou memória */               \
+static inline int name##_reserve (name##_t *dq)                                \
+{                                                                              \
+    unsigned int size, p ;                                                     \
+    type **slot ;                                                              \
+                                                                               \
+    if (dq->tail - dq->head < dq->size)                                        \
+        return (0) ;                                                           \
+                                                                               \
+    /* vetor cheio: se metade é lápide basta compactar, senão dobra */         \
+    if (dq->size && dq->dead >= dq->size / 2)                                 \
+    {                                                                          \
+        name##_compact (dq) ;                                                  \
+        return (0) ;                                                           \
+    }                                                                          \
+                                                                               \
+    size = dq->size ? 2 * dq->size : DEQUE_MIN_SIZE ;                          \
+    slot = malloc (size * sizeof (type *)) ;                                   \
+    if (!slot)                                                                 \
+        return (-1) ;                                                          \
+                                                                               \
+    /* as posições absolutas não mudam, só o lugar delas no vetor */           \
+    for (p = dq->head; p != dq->tail; p++)                                     \
+        slot[p & (size - 1)] = dq->slot[p & (dq->size - 1)] ;                  \
+    free (dq->slot) ;                                                          \
+    dq->slot = slot ;                                                          \
+    dq->size = size ;                                                          \
+    return (0) ;                                                               \
+}                                                                              \
+                                                                               \
+/* Insere no final e no início; -1 se faltou memória */                        \
+static inline int name##_push_back (name##_t *dq, type *elem)                  \
+{                                                                              \
+    if (name##_reserve (dq) < 0)                                               \
+        return (-1) ;                                                          \
+    elem->pos = dq->tail ;                                                     \
+    dq->slot[dq->tail++ & (dq->size - 1)] = elem ;                             \
+    return (0) ;                                                               \
+}                                                                              \
+                                                                               \
+static inline int name##_push_front (name##_t *dq, type *elem)                 \
+{                                                                              \
+    if (name##_reserve (dq) < 0)                                               \
+        return (-1) ;                                                          \
+    elem->pos = --dq->head ;                                                   \
+    dq->slot[dq->head & (dq->size - 1)] = elem ;                               \
+    return (0) ;                                                               \
+}                                                                              \
+                                                                               \
+/* Retira um elemento de qualquer posição; -1 se ele não está no deque */      \
+static inline int name##_remove (name##_t *dq, type *elem)                     \
+{                                                                              \
+    unsigned int mask = dq->size - 1 ;                                         \
+                                                                               \
+    if (elem->pos - dq->head >= dq->tail - dq->head                            \
+        || dq->slot[elem->pos & mask] != elem)                                 \
+        return (-1) ;                                                          \
+                                                                               \
+    dq->slot[elem->pos & mask] = NULL ;                                        \
+    dq->dead++ ;                                                               \
+                                                                               \
+    /* as pontas nunca guardam lápides */                                      \
+    while (dq->head != dq->tail && !dq->slot[dq->head & mask])                 \
+    {                                                                          \
+        dq->head++ ;                                                           \
+        dq->dead-- ;                                                           \
+    }                                                                          \
+    while (dq->head != dq->tail && !dq->slot[(dq->tail - 1) & mask])           \
+    {                                                                          \
+        dq->tail-- ;                                                           \
+        dq->dead-- ;                                                           \
+    }                                                                          \
+                                                                               \
+    if (dq->dead > DEQUE_MIN_SIZE && dq->dead > (dq->tail - dq->head) / 2)     \
+        name##_compact (dq) ;                                                  \
+    return (0) ;                                                               \
+}                                                                              \
+                                                                               \
+/* Retira e devolve o primeiro elemento, ou NULL se o deque está vazio */      \
+static inline type *name##_pop_front (name##_t *dq)                            \
+{                                                                              \
+    type *elem = name##_first (dq) ;                                           \
+                                                                               \
+    if (elem)                                                                  \
+        name##_remove (dq, elem) ;                                             \
+    return elem ;                                                              \
+}                                                                              \
+                                                                               \
+/* Move o primeiro elemento para o final (rodízio FIFO) */                     \
+static inline void name##_rotate (name##_t *dq)                                \
+{                                                                              \
+    type *elem = name##_first (dq) ;                                           \
+                                                                               \
+    /* a posição liberada em head garante o espaço no final */                 \
+    if (!elem || dq->head + 1 == dq->tail)                                     \
+        return ;                                                               \
+    name##_remove (dq, elem) ;                                                 \
+    elem->pos = dq->tail ;                                                     \
+    dq->slot[dq->tail++ & (dq->size - 1)] = elem ;                             \
+}                                                                              \
+                                                                               \
+/* Emenda os elementos de *src, em ordem, no final de *dst; src fica vazio */  \
+static inline int name##_concat (name##_t *dst, name##_t *src)                 \
+{                                                                              \
+    type *elem ;                                                               \
+                                                                               \
+    while ((elem = name##_pop_front (src)))                                    \
+        if (name##_push_back (dst, elem) < 0)                                  \
+        {                                                                      \
+            name##_push_front (src, elem) ;    /* cabe: acabou de sair */      \
+            return (-1) ;                                                      \
+        }                                                                      \
+    return (0) ;                                                               \
+}
+
+#endif
@@ -36,6 +36,20 @@ int task_create (task_t *task,			// descritor da nova tarefa
                  void (*start_func)(void *),	// funcao corpo da tarefa
                  void *arg) ;			// argumentos para a tarefa
 
+// Cria uma nova tarefa com os atributos indicados (NULL usa os padrões).
+// Retorna um ID> 0 ou erro.
+int task_create_attr (task_t *task,			// descritor da nova tarefa
+                      void (*start_func)(void *),	// funcao corpo da tarefa
+                      void *arg,			// argumentos para a tarefa
+                      const task_attr_t *attr) ;	// atributos da tarefa
+
+// Cria um grupo de pilha compartilhada, com uma pilha de "size" bytes (0 usa o
+// tamanho padrão); só funciona com a troca de contexto nativa. Retorna 0 ou erro.
+int stack_group_create (stack_group_t *group, size_t size) ;
+
+// Destroi um grupo de pilha compartilhada sem tarefas vivas. Retorna 0 ou erro.
+int stack_group_destroy (stack_group_t *group) ;
+
 // Termina a tarefa corrente, indicando um valor de status encerramento
 void task_exit (int exitCode) ;
 
@@ -62,14 +76,32 @@ int task_getprio (task_t *task) ;
 // a tarefa corrente aguarda o encerramento de outra task
 int task_join (task_t *task) ;
 
+// Esperas com prazo: as variantes _timeout esperam no máximo t milissegundos e
+// retornam -2 se o prazo venceu; os demais resultados são os da variante sem
+// prazo, exceto em task_join_timeout
+
+// aguarda o encerramento de outra task por até t ms; retorna 0 e o código de
+// encerramento dela em *exit_code (se não for NULL), -1 em caso de erro ou -2
+// se o prazo venceu
+int task_join_timeout (task_t *task, int t, int *exit_code) ;
+
 // operações de gestão do tempo ================================================
 
 // suspende a tarefa corrente por t milissegundos
 void task_sleep (int t) ;
 
+// suspende a tarefa corrente por t microssegundos (a resolução depende do
+// relógio: 1 ms no modo periódico, 1 us no modo tickless)
+void task_usleep (int t) ;
+
 // retorna o relógio atual (em milisegundos)
 unsigned int systime () ;
 
+// informa em *t o instante (em milisegundos) em que a próxima tarefa adormecida
+// deve acordar (para uma espera maior que o alcance da roda de tempo, o fim da
+// parte corrente dela); retorna 0 ou -1 se não há tarefas adormecidas
+int task_next_wakeup (unsigned int *t) ;
+
 // operações de IPC ============================================================
 
 // semáforos
@@ -77,9 +109,15 @@ unsigned int systime () ;
 // cria um semáforo com valor inicial "value"
 int sem_create (semaphore_t *s, int value) ;
 
+// define a ordem da fila do semáforo (WAIT_FIFO ou WAIT_PRIO)
+int sem_setpolicy (semaphore_t *s, int policy) ;
+
 // requisita o semáforo
 int sem_down (semaphore_t *s) ;
 
+// requisita o semáforo, esperando por até t ms
+int sem_down_timeout (semaphore_t *s, int t) ;
+
 // libera o semáforo
 int sem_up (semaphore_t *s) ;
 
@@ -91,15 +129,72 @@ int sem_destroy (semaphore_t *s) ;
 // Inicializa um mutex (sempre inicialmente livre)
 int mutex_create (mutex_t *m) ;
 
+// Define a ordem da fila do mutex (WAIT_FIFO ou WAIT_PRIO)
+int mutex_setpolicy (mutex_t *m, int policy) ;
+
 // Solicita um mutex
 int mutex_lock (mutex_t *m) ;
 
+// Solicita um mutex, esperando por até t ms
+int mutex_lock_timeout (mutex_t *m, int t) ;
+
 // Libera um mutex
 int mutex_unlock (mutex_t *m) ;
 
 // Destrói um mutex
 int mutex_destroy (mutex_t *m) ;
 
+// variáveis de condição
+
+// Inicializa uma variável de condição
+int condvar_create (condvar_t *c) ;
+
+// Define a ordem da fila da condição (WAIT_FIFO ou WAIT_PRIO)
+int condvar_setpolicy (condvar_t *c, int policy) ;
+
+// Libera o mutex m (da tarefa corrente) e espera a condição; retorna com o
+// mutex obtido novamente
+int condvar_wait (condvar_t *c, mutex_t *m) ;
+
+// Espera a condição por até t ms; -2 se o prazo venceu (o mutex é obtido
+// novamente mesmo assim)
+int condvar_wait_timeout (condvar_t *c, mutex_t *m, int t) ;
+
+// Sinaliza a condição para uma tarefa
+int condvar_signal (condvar_t *c) ;
+
+// Sinaliza a condição para todas as tarefas
+int condvar_broadcast (condvar_t *c) ;
+
+// Destrói uma variável de condição
+int condvar_destroy (condvar_t *c) ;
+
+// travas de leitura e escrita
+
+// Inicializa uma trava de leitura e escrita (inicialmente livre)
+int rwlock_create (rwlock_t *l) ;
+
+// Define a ordem da fila de escritores (WAIT_FIFO ou WAIT_PRIO)
+int rwlock_setpolicy (rwlock_t *l, int policy) ;
+
+// Solicita a trava para leitura (compartilhada)
+int rwlock_rdlock (rwlock_t *l) ;
+
+// Solicita a trava para leitura, esperando por até t ms
+int rwlock_rdlock_timeout (rwlock_t *l, int t) ;
+
+// Solicita a trava para escrita (exclusiva)
+int rwlock_wrlock (rwlock_t *l) ;
+
+// Solicita a trava para escrita, esperando por até t ms
+int rwlock_wrlock_timeout (rwlock_t *l, int t) ;
+
+// Libera a trava, obtida para leitura ou para escrita
+int rwlock_unlock (rwlock_t *l) ;
+
+// Destrói uma trava de leitura e escrita
+int rwlock_destroy (rwlock_t *l) ;
+
 // barreiras
 
 // Inicializa uma barreira
@@ -108,6 +203,9 @@ int barrier_create (barrier_t *b, int N) ;
 // Chega a uma barreira
 int barrier_join (barrier_t *b) ;
 
+// Chega a uma barreira, esperando por até t ms sua liberação
+int barrier_join_timeout (barrier_t *b, int t) ;
+
 // Destrói uma barreira
 int barrier_destroy (barrier_t *b) ;
 
@@ -116,18 +214,64 @@ int barrier_destroy (barrier_t *b) ;
 // cria uma fila para até max mensagens de size bytes cada
 int mqueue_create (mqueue_t *queue, int max, int size) ;
 
+// define a ordem das filas de emissores e receptores (WAIT_FIFO ou WAIT_PRIO)
+int mqueue_setpolicy (mqueue_t *queue, int policy) ;
+
 // envia uma mensagem para a fila
 int mqueue_send (mqueue_t *queue, void *msg) ;
 
 // recebe uma mensagem da fila
 int mqueue_recv (mqueue_t *queue, void *msg) ;
 
+// envia uma mensagem para a fila, esperando espaço por até t ms
+int mqueue_send_timeout (mqueue_t *queue, void *msg, int t) ;
+
+// recebe uma mensagem da fila, esperando por até t ms
+int mqueue_recv_timeout (mqueue_t *queue, void *msg, int t) ;
+
 // destroi a fila, liberando as tarefas bloqueadas
 int mqueue_destroy (mqueue_t *queue) ;
 
 // informa o número de mensagens atualmente na fila
 int mqueue_msgs (mqueue_t *queue) ;
 
+// reserva a próxima posição livre da fila (bloqueia se está cheia) e retorna
+// um ponteiro para a mensagem ser escrita diretamente nela, ou NULL se a fila
+// foi destruída
+void *mqueue_reserve (mqueue_t *queue) ;
+
+// publica uma mensagem obtida com mqueue_reserve
+int mqueue_commit (mqueue_t *queue, void *msg) ;
+
+// retorna um ponteiro para a mensagem mais antiga (bloqueia se a fila está
+// vazia), para ser lida diretamente na fila, ou NULL se a fila foi destruída
+void *mqueue_peek (mqueue_t *queue) ;
+
+// libera a posição de uma mensagem obtida com mqueue_peek
+int mqueue_release (mqueue_t *queue, void *msg) ;
+
+// envia até n mensagens consecutivas de msgs (bloqueia só se a fila está
+// cheia); retorna quantas foram enviadas, ou -1 se a fila foi destruída
+int mqueue_send_batch (mqueue_t *queue, void *msgs, int n) ;
+
+// recebe até n mensagens em msgs (bloqueia só se a fila está vazia); retorna
+// quantas foram recebidas, ou -1 se a fila foi destruída
+int mqueue_recv_batch (mqueue_t *queue, void *msgs, int n) ;
+
+// esperas por endereço
+
+// bloqueia a tarefa corrente enquanto *addr == expected, até um ppos_wake no
+// mesmo endereço; retorna 0 se foi acordada (o chamador deve conferir *addr de
+// novo), -3 sem bloquear se *addr já era diferente de expected ou -1 em caso
+// de erro
+int ppos_wait (int *addr, int expected) ;
+
+// como ppos_wait, esperando por até t ms; -2 se o prazo venceu
+int ppos_wait_timeout (int *addr, int expected, int t) ;
+
+// acorda até n tarefas esperando em addr (n < 0: todas); retorna quantas
+int ppos_wake (int *addr, int n) ;
+
 //==============================================================================
 
 // Redefinir funcoes POSIX "proibidas" como "FORBIDDEN" (gera erro ao compilar)
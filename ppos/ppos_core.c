@@ -5,566 +5,3464 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/time.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
 #include "ppos_data.h"
 #include "ppos.h"
-
-#define STACKSIZE 64*1024	                                // tamanho de pilha das threads 
-#define ALPHA_AGING -1                                      // define o task aging α = -1
+#include "queue_inline.h"
+
+#define STACKSIZE 64*1024	                                // tamanho padrão de pilha das threads 
+#define STACK_MIN (16*1024)                                 // menor pilha aceita por task_create_attr
+#define STACK_CLASSES (8 * sizeof (size_t))                 // classes de tamanho de pilha (uma por potência de 2)
+#define STACK_POOL_MAX 64                                   // pilhas livres guardadas por classe
+#define STACK_GROUP_SIZE (1024*1024)                        // tamanho padrão de uma pilha compartilhada
+#define STACK_SAVE_ALIGN 256                                // granularidade das áreas de salvamento das pilhas compartilhadas
+#define ALPHA_AGING -1                                      // define o task aging α = -1 (uma época = um nível)
 #define QUANTUM_SIZE 20                                     // quantidade de ticks que cada tarefa recebe para ser executada
 
+// 1: a decisão de escalonamento roda na pilha da tarefa que libera o processador,
+// que troca direto para a próxima; o dispatcher só é ativado quando não há tarefas
+// prontas ou para liberar uma tarefa encerrada. 0: toda troca passa pelo dispatcher
+#ifndef DIRECT_SWITCH
+#define DIRECT_SWITCH 1
+#endif
+
+// 1 (wake-affine): quando a tarefa que acordou outra (sem_up, mutex_unlock,
+// mqueue_send, ppos_wake, task_exit acordando quem a espera, ...) libera o
+// processador antes do fim do quantum, ela troca direto para a tarefa acordada
+// e lhe doa o que resta do quantum, se a prioridade (estática ou herdada) da
+// acordada é ao menos tão boa quanto a dela e a das demais prontas. 0: a
+// tarefa acordada entra no fim do seu balde na fila de prontas
+#ifndef WAKE_AFFINE
+#define WAKE_AFFINE 0
+#endif
+
+// 1: escalonamento por filas multinível com realimentação (MLFQ). Cada tarefa
+// tem um nível; o nível soma MLFQ_STEP à sua prioridade e multiplica o quantum
+// (o padrão no nível 0, mais longo nos seguintes). A tarefa que gasta o quantum
+// inteiro desce um nível; a que bloqueia (task_sleep, task_join e demais
+// esperas) antes disso sobe um, e a que acorda com prioridade maior que a da
+// tarefa atual toma o processador. A cada MLFQ_BOOST_MS todas as tarefas
+// prontas voltam ao nível 0, o que substitui o envelhecimento contra a
+// inanição. 0: prioridades com envelhecimento e quantum único
+#ifndef SCHED_MLFQ
+#define SCHED_MLFQ 0
+#endif
+
+#if SCHED_MLFQ
+#define MLFQ_LEVELS 3                                       // quantidade de níveis
+#define MLFQ_STEP 10                                        // prioridade somada a cada nível
+#define MLFQ_BOOST_MS 1000                                  // período em que todas as tarefas prontas voltam ao nível 0
+#endif
+
+// 0: o relógio é um contador de ticks de 1 ms, incrementado por um SIGALRM
+// periódico. 1 (tickless): o relógio é lido de CLOCK_MONOTONIC, com resolução de
+// 1 us, e um temporizador de disparo único (timer_create) é programado para o
+// primeiro evento: o fim do quantum da tarefa atual ou o prazo da próxima tarefa
+// adormecida. Em glibc anteriores à 2.17 é preciso ligar com -lrt
+#ifndef TICKLESS
+#define TICKLESS 0
+#endif
+
+#if TICKLESS
+#define TICK_USEC 1                                         // duração de um tick do relógio interno, em micro-segundos
+#ifndef QUANTUM_USEC
+#define QUANTUM_USEC (QUANTUM_SIZE * 1000)                  // quantum em micro-segundos (pode ser menor que 1 ms)
+#endif
+#else
+#define TICK_USEC 1000
+#endif
+
+#if TICKLESS
+#define QUANTUM_TICKS (QUANTUM_USEC / TICK_USEC)            // quantum em ticks do relógio interno
+#else
+#define QUANTUM_TICKS QUANTUM_SIZE
+#endif
+
+#if SCHED_MLFQ
+// quantum do nível: o quantum padrão no nível 0, dobrado a cada nível
+#define MLFQ_QUANTUM(level) (QUANTUM_TICKS << (level))
+#endif
+
+// maior espera colocada de uma vez na roda de tempo: metade do alcance com
+// sinal dela, o que deixa margem para o relógio da roda estar atrasado
+#define SLEEP_MAX_TICKS 0x3FFFFFFFU
+
+// Operações em linha sobre filas de tarefas (taskq_append, taskq_remove, ...)
+// e sobre as filas da roda de tempo, que usam o segundo par de ponteiros
+QUEUE_INLINE (taskq, task_t)
+QUEUE_INLINE_LINK (timerq, task_t, timer_prev, timer_next)
+
+#define WAIT_TIMEOUT (-2)                                   // resultado de uma espera cujo prazo venceu
+#define WAIT_CHANGED (-3)                                   // ppos_wait sem esperar: o valor já era outro
+
+#ifndef WAIT_BITS
+#define WAIT_BITS 8                                         // bits do hash da tabela de esperas por endereço
+#endif
+#define WAIT_BUCKETS (1 << WAIT_BITS)                       // filas da tabela de esperas por endereço
+
+#if READY_DEQUE
+DEQUE_INLINE (taskdq, task_t, ready_pos)
+#endif
+
 int TaskIDCounter, UserTasks ;                             // contador de IDs para criação de tarefas e quantidade de tarefas do usuário
 task_t MainTask, DispatcherTask ;                          // Tarefa principal e Dispatcher
-task_t *CurrentTask, *ReadyQueue, *SleepingQueue ;         // aponta para tarefa atual, para fila de prontas e fila de dormentes
+task_t *CurrentTask, *PreviousTask ;                       // aponta para tarefa atual e para a que executava antes dela
+timer_wheel_t SleepingWheel ;                              // roda de tempo das tarefas adormecidas
+ready_queue_t ReadyQueue ;                                 // fila de prontas, organizada por prioridade dinâmica
+task_t *WaitBuckets[WAIT_BUCKETS] ;                        // tarefas em ppos_wait, espalhadas pelo endereço esperado
 struct sigaction action ;                                  // define um tratador de sinal 
 struct itimerval timer ;                                   // estrutura de inicialização do timer
 unsigned int TicksRemaining, TicksTimer ;                  // ticks que restam para a tarefa atual executar e o total de ticks que aconteceram no programa
 unsigned int ProcessorYieldTime ;                          // momento que o processador foi entregue a tarefa atual
-int CoreFunctionAtivated;                                  // booleano que define se uma função do core está ativada, então não deve ser feira a preempção
+int PreemptDisabled ;                                      // contador aninhável: enquanto > 0 uma função do core está ativa e não há preempção
+int PreemptPending ;                                       // o quantum acabou enquanto a preempção estava desativada
+#if SCHED_MLFQ
+unsigned int MlfqBoostTime ;                               // tick do último retorno de todas as tarefas ao nível 0
+int WakePending ;                                          // há tarefas adormecidas a conferir no próximo preempt_enable
+int WakePreempt ;                                          // a preempção marcada é por uma tarefa acordada, não pelo fim do quantum
+#endif
+#if WAKE_AFFINE
+task_t *AffineTask ;                                       // tarefa acordada pela tarefa atual, candidata a executar em seguida
+unsigned int AffineTicks ;                                 // resto do quantum doado a ela (0: nenhuma doação)
+#endif
+void *StackPool[STACK_CLASSES] ;                           // pilhas livres, por classe de tamanho
+int StackPoolCount[STACK_CLASSES] ;                        // quantidade de pilhas livres em cada classe
+size_t PageSize ;                                          // tamanho da página (e da página de guarda das pilhas)
+#ifdef NATIVE_SWITCH
+void *CopierContext ;                                      // contexto do copiador de pilhas compartilhadas
+void *CopierStack ;                                        // pilha própria do copiador
+task_t *CopyTarget ;                                       // tarefa que o copiador deve colocar na pilha compartilhada
+#endif
+#if TICKLESS
+struct timespec ClockOrigin ;                              // instante de CLOCK_MONOTONIC em que o sistema foi iniciado
+timer_t OneShotTimer ;                                     // temporizador de disparo único
+unsigned int QuantumDeadline ;                             // tick em que acaba o quantum da tarefa atual
+unsigned int TimerExpiry ;                                 // tick para o qual o temporizador está programado
+int TimerArmed ;                                           // o temporizador está programado e ainda não disparou
+int TimerPending ;                                         // o temporizador disparou enquanto a preempção estava desativada
+#endif
+
+// troca de contexto ============================================================
+
+// Corpo inicial de toda tarefa: chama a função da tarefa com seu argumento
+void task_bootstrap ()
+{
+    // a tarefa começa fora do núcleo (a troca que a ativou não retorna aqui)
+    PreemptDisabled = 0 ;
+
+    CurrentTask->start_func (CurrentTask->start_arg) ;
+
+    // a tarefa retornou sem chamar task_exit (equivale a uc_link = 0)
+    exit (0) ;
+}
+
+#ifdef NATIVE_SWITCH
+
+// salva o contexto atual em *save_sp e retoma o contexto salvo em load_sp
+void context_switch (void **save_sp, void *load_sp) ;
+
+// ponto de entrada de um contexto novo: chama a função preparada por context_prepare ()
+void context_start () ;
+
+#ifdef __APPLE__
+#define ASM_SYMBOL(name) "_" #name
+#else
+#define ASM_SYMBOL(name) #name
+#endif
+
+#if defined(__x86_64__)
+
+// Pilha salva (do topo para a base): endereço de retorno, rbp, rbx, r12-r15 e
+// as palavras de controle de ponto flutuante (mxcsr e x87)
+#define CONTEXT_FRAME 8
+
+__asm__ (
+    ".text\n"
+    ".globl " ASM_SYMBOL(context_switch) "\n"
+    ".p2align 4\n"
+    ASM_SYMBOL(context_switch) ":\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".globl " ASM_SYMBOL(context_start) "\n"
+    ".p2align 4\n"
+    ASM_SYMBOL(context_start) ":\n"
+    "    callq *%r12\n"
+    "    ud2\n"
+) ;
+
+// Monta a pilha inicial de um contexto como se ela tivesse sido salva por
+// context_switch; ao ser retomado, o contexto chama entry ()
+void *context_prepare (void *stack, size_t size, void (*entry) ())
+{
+    uint64_t *sp = (uint64_t *) (((uintptr_t) stack + size) & ~(uintptr_t) 15) ;
+
+    sp -= CONTEXT_FRAME ;
+    sp[0] = 0x0000037F00001F80ULL ;             // fcw | mxcsr padrões
+    sp[1] = 0 ;                                 // r15
+    sp[2] = 0 ;                                 // r14
+    sp[3] = 0 ;                                 // r13
+    sp[4] = (uint64_t) (uintptr_t) entry ;           // r12
+    sp[5] = 0 ;                                 // rbx
+    sp[6] = 0 ;                                 // rbp
+    sp[7] = (uint64_t) (uintptr_t) context_start ;   // endereço de retorno
+
+    return sp ;
+}
+
+#elif defined(__aarch64__)
+
+// Pilha salva: x19-x30, d8-d15 (a metade preservada de v8-v15) e fpcr
+#define CONTEXT_FRAME 22
+
+__asm__ (
+    ".text\n"
+    ".globl " ASM_SYMBOL(context_switch) "\n"
+    ".p2align 4\n"
+    ASM_SYMBOL(context_switch) ":\n"
+    "    sub sp, sp, #176\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mrs x9, fpcr\n"
+    "    str x9, [sp, #160]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldr x9, [sp, #160]\n"
+    "    msr fpcr, x9\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #176\n"
+    "    ret\n"
+    ".globl " ASM_SYMBOL(context_start) "\n"
+    ".p2align 4\n"
+    ASM_SYMBOL(context_start) ":\n"
+    "    blr x19\n"
+    "    brk #0\n"
+) ;
+
+// Monta a pilha inicial de um contexto como se ela tivesse sido salva por
+// context_switch; ao ser retomado, o contexto chama entry ()
+void *context_prepare (void *stack, size_t size, void (*entry) ())
+{
+    uint64_t *sp = (uint64_t *) (((uintptr_t) stack + size) & ~(uintptr_t) 15) ;
+    int i ;
+
+    sp -= CONTEXT_FRAME ;
+    for (i = 0; i < CONTEXT_FRAME; i++)
+        sp[i] = 0 ;
+    sp[0] = (uint64_t) (uintptr_t) entry ;           // x19
+    sp[11] = (uint64_t) (uintptr_t) context_start ;  // x30 (endereço de retorno)
+
+    return sp ;
+}
+
+#endif
+#endif
+
+// preempção ====================================================================
+
+// Desativa a preempção (pode ser aninhada)
+void preempt_disable ()
+{
+    PreemptDisabled++ ;
+}
+
+#if TICKLESS
+// trata um disparo do temporizador que ocorreu dentro do núcleo
+void timer_expired () ;
+#elif SCHED_MLFQ
+// trata um tick com tarefas adormecidas que ocorreu dentro do núcleo
+void mlfq_wakeup () ;
+#endif
+#if SCHED_MLFQ
+void mlfq_preempt_check () ;
+#endif
+
+// Reativa a preempção; ao sair da última seção crítica, faz a preempção que
+// ficou pendente enquanto ela estava desativada
+void preempt_enable ()
+{
+    PreemptDisabled-- ;
+
+    #if TICKLESS
+    if (!PreemptDisabled && TimerPending)
+        timer_expired () ;
+    #elif SCHED_MLFQ
+    if (!PreemptDisabled && WakePending)
+        mlfq_wakeup () ;
+    #endif
+
+    if (!PreemptDisabled && PreemptPending)
+        task_yield () ;
+}
 
 // funções timer =================================================================
 
 // trata o sinal recebido do timer
 void handler (int signum)
 {
+    #if TICKLESS
+    // o temporizador é de disparo único: o próximo é programado ao tratar este
+    TimerArmed = 0 ;
+    TimerPending = 1 ;
+    if (PreemptDisabled)
+        return ;
+    #else
     TicksTimer++ ;
     //printf("syst %d\n", systime ());
 
-    // não faz preempção se estiver rodando uma tarefa do sistema/core
-    if(CoreFunctionAtivated)
-        return ;
-    
+    // o quantum é contado mesmo durante as funções do core
     if (TicksRemaining > 0)
     {
         TicksRemaining-- ;
+        #if SCHED_MLFQ
+        // com tarefas adormecidas, o preempt_enable confere a cada tick se
+        // alguma acordou com prioridade maior que a da tarefa atual
+        if (SleepingWheel.count)
+            WakePending = 1 ;
+        if (!WakePending || PreemptDisabled)
+            return ;
+        #else
+        return ;
+        #endif
     }
     else
     {
-        task_yield() ;
+        // o quantum acabou durante uma função do core: a preempção é feita
+        // quando ela sair da seção crítica (preempt_enable)
+        if (PreemptDisabled)
+        {
+            PreemptPending = 1 ;
+            return ;
+        }
+
+        PreemptPending = 1 ;
     }
+    #endif
+
+    // o disparo ocorreu durante código da tarefa, que não tem outro ponto de
+    // entrada no núcleo; a troca de contexto não restaura a máscara de sinais,
+    // então o SIGALRM é liberado aqui para que a próxima tarefa não rode com ele bloqueado
+    sigset_t alarm ;
+
+    preempt_disable () ;
+    sigemptyset (&alarm) ;
+    sigaddset (&alarm, SIGALRM) ;
+    sigprocmask (SIG_UNBLOCK, &alarm, NULL) ;
+    preempt_enable () ;
 } 
 
+#if TICKLESS
+
+// retorna os micro-segundos passados desde o início do sistema
+unsigned long long clock_usec ()
+{
+    struct timespec now ;
+
+    clock_gettime (CLOCK_MONOTONIC, &now) ;
+    return (unsigned long long) (((now.tv_sec - ClockOrigin.tv_sec) * 1000000000LL
+                                  + (now.tv_nsec - ClockOrigin.tv_nsec)) / 1000) ;
+}
+
+// retorna o relógio interno, em ticks de TICK_USEC desde o início do sistema
+unsigned int clock_ticks ()
+{
+    return (unsigned int) clock_usec () ;
+}
+
 // retorna o relógio atual (em milisegundos)
 unsigned int systime ()
 {
-    return TicksTimer ;
-}
+    struct timespec now ;
 
+    clock_gettime (CLOCK_MONOTONIC, &now) ;
+    return (unsigned int) (((now.tv_sec - ClockOrigin.tv_sec) * 1000000000LL
+                            + (now.tv_nsec - ClockOrigin.tv_nsec)) / 1000000) ;
+}
 
-// funções dispatcher/scheduler ==================================================
+int wheel_next_deadline (unsigned int *t) ;
 
-// Faz o envelhecimento das tarefas task na frequencia task_aging
-void perform_task_aging (task_t *task, int task_aging)
+// Programa o temporizador para o primeiro evento pendente: o fim do quantum da
+// tarefa atual (só se há outra tarefa pronta para ocupar o processador) ou o
+// prazo da próxima tarefa adormecida. Um disparo programado para antes do
+// necessário é mantido; ao disparar sem nada a fazer ele é reprogramado, o que
+// evita uma chamada de sistema a cada troca de contexto.
+void timer_program ()
 {
-    if (!task)
+    struct itimerspec value = {0} ;
+    unsigned long long now ;
+    long long target ;
+    unsigned int expiry = 0, wakeup ;
+    int event = 0, delta ;
+
+    if (CurrentTask != &DispatcherTask && (ReadyQueue.count > 1 || ReadyQueue.wake))
     {
-        #ifdef DEBUG
-            printf("perform_task_aging: não há tasks para envelhecer") ;
-        #endif
-        return;
+        expiry = QuantumDeadline ;
+        event = 1 ;
     }
 
-    int new_prio ;
-    task_t* first = task ;
-    do
+    if (!wheel_next_deadline (&wakeup) && (!event || (int) (wakeup - expiry) < 0))
     {
-        new_prio = task->prio_dinamic + task_aging ;
+        expiry = wakeup ;
+        event = 1 ;
+    }
 
-        // Evita que a prioridade seja maior ou menos que o intervalo definido
-        if (new_prio < -20) new_prio = -20 ;
-        else if (new_prio > 20) new_prio = 20 ;
-        
-        #ifdef DEBUG_PRIO
-            printf("PPOS: a prioridade da tarefa %d agora é %d\n", task->id, new_prio) ;
-        #endif
+    if (!event)
+        return ;
 
-        task->prio_dinamic = new_prio ;
+    if (TimerArmed && (int) (TimerExpiry - expiry) <= 0)
+        return ;
 
-        task = task->next ;
-    } while (task != first) ;
+    // marca antes de programar: um disparo logo após timer_settime desfaz a marca
+    TimerExpiry = expiry ;
+    TimerArmed = 1 ;
+
+    now = clock_usec () ;
+    delta = (int) (expiry - (unsigned int) now) ;
+    if (delta < 1)
+        delta = 1 ;
+
+    // o disparo é programado num instante absoluto de CLOCK_MONOTONIC: uma
+    // demora entre a leitura do relógio e timer_settime não o atrasa
+    target = ClockOrigin.tv_nsec + (long long) (now + delta) * 1000 ;
+    value.it_value.tv_sec = ClockOrigin.tv_sec + target / 1000000000 ;
+    value.it_value.tv_nsec = target % 1000000000 ;
+    if (timer_settime (OneShotTimer, TIMER_ABSTIME, &value, NULL) < 0)
+    {
+        perror ("Erro em timer_settime: ") ;
+        exit (1) ;
+    }
 }
 
-// Verifica se está na hora e acorda as tarefas que precisam ser acordadas
-void perform_task_awakening ()
+void perform_task_awakening () ;
+
+// Trata um disparo do temporizador, com a preempção ativada: acorda as tarefas
+// cujo prazo venceu, reprograma o temporizador e, se o quantum acabou, marca a
+// preempção (feita pelo preempt_enable que chamou esta função)
+void timer_expired ()
 {
-    if (!SleepingQueue) return;
+    preempt_disable () ;
 
-    task_t *task = SleepingQueue ;
-    task_t *next ;
-    do
+    TimerPending = 0 ;
+    perform_task_awakening () ;
+
+    // com o quantum vencido, o próximo disparo é programado pela troca de contexto
+    if (CurrentTask != &DispatcherTask && (int) (clock_ticks () - QuantumDeadline) >= 0)
+        PreemptPending = 1 ;
+    else
     {
-        next = task->next ;
+        #if SCHED_MLFQ
+        mlfq_preempt_check () ;
+        #endif
+        timer_program () ;
+    }
 
-        if (task->awakening_time <= systime ())
-       {
-            task->state = READY ;
+    PreemptDisabled-- ;
+}
 
-            // Remove da fila de dormentes
-            queue_remove((queue_t **) &SleepingQueue, (queue_t *) task)  ;
+#else
 
-            // Adiciona na fila de prontas
-            queue_append ((queue_t **) &ReadyQueue, (queue_t *) task) ; 
-       }
+// retorna o relógio interno, em ticks de TICK_USEC desde o início do sistema
+unsigned int clock_ticks ()
+{
+    return TicksTimer ;
+}
 
-        if (task == next) break ;
-        task = next ;
-    } while ( task != SleepingQueue) ;
+// retorna o relógio atual (em milisegundos)
+unsigned int systime ()
+{
+    return TicksTimer ;
 }
 
-// Faz o escalonamento de tarefas
-task_t* scheduler()
+#endif
+
+// Converte um prazo em milissegundos para ticks do relógio interno
+long long ms_ticks (int t)
+{
+    return (long long) t * 1000 / TICK_USEC ;
+}
+
+// Inicia um novo quantum para a tarefa atual
+void quantum_start ()
 {
-    if (!ReadyQueue)
+    #if SCHED_MLFQ
+    unsigned int ticks = MLFQ_QUANTUM (CurrentTask->sched_level) ;
+    #else
+    unsigned int ticks = QUANTUM_TICKS ;
+    #endif
+
+    #if WAKE_AFFINE
+    // a tarefa escolhida por afinidade recebe só o resto do quantum de quem a
+    // acordou (no caminho pelo dispatcher, ele não consome a doação)
+    if (AffineTicks && CurrentTask != &DispatcherTask)
     {
-        perform_task_awakening () ;
-        return NULL ;
+        ticks = AffineTicks ;
+        AffineTicks = 0 ;
     }
-    
-    int higher_prio = 21 ;       // A valor da prioriedade
-    task_t* prio_task ;         // Higher priority task, tarefa com maior prioridade
-    task_t* task = ReadyQueue;
+    #endif
 
-    perform_task_aging (ReadyQueue, ALPHA_AGING) ;
-    perform_task_awakening () ;
+    #if TICKLESS
+    QuantumDeadline = clock_ticks () + ticks ;
+    #else
+    TicksRemaining = ticks ;
+    #endif
+    PreemptPending = 0 ;
+    #if SCHED_MLFQ
+    WakePreempt = 0 ;
+    #endif
 
-    do
-    {
-        if (task->prio_dinamic < higher_prio)
-        {
-            higher_prio = task->prio_dinamic ;
-            prio_task = task ;
-        }
+    #if TICKLESS
+    timer_program () ;
+    #endif
+}
 
-        task = task->next ;
-    } while (task != ReadyQueue);
 
-    // A tarefa de maior prioridade recebe sua prioridade estática
-    prio_task->prio_dinamic = task_getprio(prio_task) ;
-    return prio_task ;
+// pilhas =======================================================================
+
+// Retorna a classe de tamanho de uma pilha: o expoente da menor potência de 2
+// maior ou igual a size (e maior ou igual a STACK_MIN)
+int stack_class (size_t size)
+{
+    int class = 0 ;
+
+    if (size < STACK_MIN)
+        size = STACK_MIN ;
+
+    while (((size_t) 1 << class) < size)
+        class++ ;
+
+    return class ;
 }
 
-// Libera as estruturas usadas nas tarefa
-int free_task_structures (task_t *task) {
-    if (!task)
+// Aloca uma pilha da classe indicada: reaproveita uma pilha livre ou mapeia uma
+// nova, com uma página de guarda sem acesso logo abaixo dela (as pilhas crescem
+// para baixo), de forma que um estouro gera SIGSEGV em vez de corromper outra
+// área. As páginas de um mapeamento novo só ocupam memória quando são usadas.
+void *stack_alloc (int class)
+{
+    size_t size = (size_t) 1 << class ;
+    char *stack, *map ;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS ;
+
+    // a ligação da lista de livres fica no topo da pilha, que já foi usado
+    if (StackPool[class])
     {
-        perror ("Erro, task inválido: ") ;
-        return (-2) ;
+        stack = StackPool[class] ;
+        StackPool[class] = *(void **) (stack + size - sizeof (void *)) ;
+        StackPoolCount[class]-- ;
+        return stack ;
     }
 
-    #ifdef DEBUG
-        printf("Vou free() a task %d\n", task->id) ;
+    #ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE ;
+    #endif
+    #ifdef MAP_STACK
+    flags |= MAP_STACK ;
     #endif
 
-    free (task->context.uc_stack.ss_sp) ;
+    map = mmap (NULL, size + PageSize, PROT_READ | PROT_WRITE, flags, -1, 0) ;
+    if (map == MAP_FAILED)
+        return NULL ;
 
-    #ifdef DEBUG
-        printf("PPOS: Free() aconteceu com sucesso\n") ;
-    #endif
+    if (mprotect (map, PageSize, PROT_NONE) < 0)
+    {
+        munmap (map, size + PageSize) ;
+        return NULL ;
+    }
 
-    return (0);
+    return map + PageSize ;
 }
 
-// Faz o controle geral do programa
-void dispatcher ()
+// Desfaz o mapeamento de uma pilha (com a página de guarda), devolvendo a
+// memória dela ao sistema
+void stack_unmap (void *stack, int class)
+{
+    munmap ((char *) stack - PageSize, ((size_t) 1 << class) + PageSize) ;
+}
+
+// Devolve uma pilha: fica na lista de livres da classe, se ela não estiver
+// cheia; senão o mapeamento é desfeito
+void stack_free (void *stack, int class)
 {
-    CoreFunctionAtivated = 1 ;
+    size_t size = (size_t) 1 << class ;
 
-    task_t* next ;
+    if (!stack)
+        return ;
 
-    while (UserTasks > 0)
+    if (StackPoolCount[class] < STACK_POOL_MAX)
     {
-        CoreFunctionAtivated = 1 ;
-        next = scheduler() ;
-        if (next)
-        {
-            task_switch(next) ;
+        *(void **) ((char *) stack + size - sizeof (void *)) = StackPool[class] ;
+        StackPool[class] = stack ;
+        StackPoolCount[class]++ ;
+        return ;
+    }
 
-            switch (next->state)
-            {
-                case READY:
-                    break;
+    stack_unmap (stack, class) ;
+}
 
-                case EXITED:
-                    // Remove da fila e libera estruturas
-                    queue_remove((queue_t **) &ReadyQueue, (queue_t *) next) ;
-                    free_task_structures(next) ;
-                    break ;
-                
-                case SUSPENDED:
-                    printf("Entrou em uma tarefa suspensa na fila de prontas\n") ;
-                    break ;
 
-                case SLEEPING:
-                    break ;
+// pilhas compartilhadas ========================================================
 
-                default:
-                    perror("Estado da tarefa está inválido.") ;
-                    exit (1) ;
-            }
+#ifdef NATIVE_SWITCH
+
+// Guarda a parte usada da pilha compartilhada (do ponteiro de pilha salvo até o
+// topo) na área de salvamento da tarefa, que cresce conforme a profundidade
+void stack_group_save (task_t *task)
+{
+    stack_group_t *group = task->stack_group ;
+    char *top = (char *) group->stack + group->size ;
+    size_t used = top - (char *) task->context ;
+    size_t size ;
+    void *save ;
+
+    if (used > task->stack_save_size)
+    {
+        size = (used + STACK_SAVE_ALIGN - 1) & ~(size_t) (STACK_SAVE_ALIGN - 1) ;
+        save = realloc (task->stack_save, size) ;
+        if (!save)
+        {
+            perror ("Erro ao salvar pilha compartilhada: ") ;
+            exit (1) ;
         }
+        task->stack_save = save ;
+        task->stack_save_size = size ;
     }
-    task_exit (0) ; 
-}
 
+    memcpy (task->stack_save, task->context, used) ;
+    task->stack_saved = used ;
+}
 
-// funções gerais ==============================================================
-
-void ppos_init ()
+// Corpo do copiador: roda na sua própria pilha, e por isso pode sobrescrever a
+// pilha compartilhada; guarda o conteúdo da tarefa dona, copia de volta o da
+// tarefa que vai executar e troca para ela
+void stack_copier ()
 {
-    // desativa o buffer da saida padrao (stdout), usado pela função printf 
-    setvbuf (stdout, 0, _IONBF, 0) ;
-
-    // definições das variávies globais
-    TaskIDCounter = 0 ;
-    UserTasks = 0 ;                        
-    ReadyQueue = NULL ;
-    CoreFunctionAtivated = 1 ;
-    
-    // Configuração da tarefa principal
-    getcontext(&MainTask.context) ;
-    char *stack ;
+    stack_group_t *group ;
+    task_t *task ;
 
-    stack = malloc (STACKSIZE) ;
-    if (stack)
+    for (;;)
     {
-      MainTask.context.uc_stack.ss_sp = stack ;
-      MainTask.context.uc_stack.ss_size = STACKSIZE ;
-      MainTask.context.uc_stack.ss_flags = 0 ;
-      MainTask.context.uc_link = 0 ;
-   }
-   else
-   {
-      perror ("Erro na criação da pilha: ") ;
-      exit (1) ;
-   }
-
-    MainTask.id = (int) TaskIDCounter ;
-    MainTask.prev = NULL ;
-    MainTask.next = NULL ;
-
-    CurrentTask = &MainTask ;
-    MainTask.state = READY ;
+        task = CopyTarget ;
+        group = task->stack_group ;
 
-    UserTasks++ ;                                                               // Incrementa contator de tarefas de usuário ativas
-    queue_append ((queue_t **) &ReadyQueue, (queue_t *) &MainTask) ;             // Adiciona a fila de prontas
+        if (group->owner)
+            stack_group_save (group->owner) ;
 
-    // =================================================
+        memcpy (task->context, task->stack_save, task->stack_saved) ;
+        group->owner = task ;
 
-    // Criação do Dispatcher (tarefa 1)
-    task_create (&DispatcherTask, dispatcher, "dispatcher") ;
+        context_switch (&CopierContext, task->context) ;
+    }
+}
 
-    // Configuração de sinais e tempo:
-    // registra a ação para o sinal de timer SIGALRM
-    TicksTimer = 0 ;
-    ProcessorYieldTime = 0 ;
+int stack_group_create (stack_group_t *group, size_t size)
+{
+    int class ;
 
-    action.sa_handler = handler ;
-    sigemptyset (&action.sa_mask) ;
-    action.sa_flags = 0 ;
-    if (sigaction (SIGALRM, &action, 0) < 0)
+    if (!group)
     {
-        perror ("Erro em sigaction: ") ;
-        exit (1) ;
+        perror ("stack_group_create: group inválido") ;
+        return (-2) ;
     }
 
-    // ajusta valores do temporizador
-    timer.it_value.tv_usec = 1000 ;             // primeiro disparo, em micro-segundos
-    timer.it_value.tv_sec  = 0 ;                // primeiro disparo, em segundos
-    timer.it_interval.tv_usec = 1000 ;          // disparos subsequentes, em micro-segundos
-    timer.it_interval.tv_sec  = 0 ;             // disparos subsequentes, em segundos
+    preempt_disable () ;
 
-    // arma o temporizador ITIMER_REAL (vide man setitimer)
-    if (setitimer (ITIMER_REAL, &timer, 0) < 0)
+    // o copiador é criado junto com o primeiro grupo
+    if (!CopierStack)
     {
-        perror ("Erro em setitimer: ") ;
-        exit (1) ;
+        CopierStack = stack_alloc (stack_class (STACK_MIN)) ;
+        if (!CopierStack)
+        {
+            perror ("Erro na criação da pilha do copiador: ") ;
+            preempt_enable () ;
+            return (-1) ;
+        }
+        CopierContext = context_prepare (CopierStack, (size_t) 1 << stack_class (STACK_MIN), stack_copier) ;
     }
 
+    class = stack_class (size ? size : STACK_GROUP_SIZE) ;
+    group->stack = stack_alloc (class) ;
+    if (!group->stack)
+    {
+        perror ("Erro na criação da pilha compartilhada: ") ;
+        preempt_enable () ;
+        return (-1) ;
+    }
 
-    #ifdef DEBUG
-    printf ("PPOS: Ping Pong OS inicializado\n") ;
-    #endif
+    group->size = (size_t) 1 << class ;
+    group->owner = NULL ;
+    group->tasks = 0 ;
 
-    CoreFunctionAtivated = 0 ;
-    task_yield () ;
+    preempt_enable () ;
+    return (0) ;
 }
 
-// gerência de tarefas =========================================================
-
-int task_create (task_t *task, void (*start_func)(void *), void *arg)
+int stack_group_destroy (stack_group_t *group)
 {
-    CoreFunctionAtivated = 1 ;                            // para evitar que funções de nucleo sofram preempção
-
-    if (!task)
+    if (!group || !group->stack)
     {
-        perror ("Erro na criação de nova tarefa, task inválido: ") ;
+        perror ("stack_group_destroy: group inválido") ;
         return (-2) ;
     }
 
-    if (!start_func)
+    if (group->tasks)
     {
-        perror ("Erro na criação de nova tarefa, start_func inválido: ") ;
-        return (-3) ;
+        perror ("stack_group_destroy: o grupo ainda tem tarefas") ;
+        return (-1) ;
     }
 
-    // Faz a configuração do contexto da tarefa
-    char *stack ;
+    // a pilha compartilhada costuma ter sido usada a fundo: é desmapeada em vez
+    // de ir para a lista de livres, que guardaria a memória tocada
+    preempt_disable () ;
+    stack_unmap (group->stack, stack_class (group->size)) ;
+    group->stack = NULL ;
+    preempt_enable () ;
 
-    getcontext (&task->context) ;
+    return (0) ;
+}
 
-    stack = malloc (STACKSIZE) ;
-    if (stack)
-    {
-      task->context.uc_stack.ss_sp = stack ;
-      task->context.uc_stack.ss_size = STACKSIZE ;
-      task->context.uc_stack.ss_flags = 0 ;
-      task->context.uc_link = 0 ;
-   }
-   else
-   {
-      perror ("Erro na criação da pilha: ") ;
-      return (-1) ;
-   }
+#else
 
-    makecontext (&task->context, (void*)(*start_func), 1, arg) ;
+// sem a troca de contexto nativa não se conhece o ponteiro de pilha salvo
+int stack_group_create (stack_group_t *group, size_t size)
+{
+    perror ("stack_group_create: pilha compartilhada requer a troca de contexto nativa") ;
+    return (-1) ;
+}
 
-    TaskIDCounter++ ;                       // Incrementa contatos de IDs           
+int stack_group_destroy (stack_group_t *group)
+{
+    return (-1) ;
+}
 
-    // Se não for tarefa main ou o dispatcher:
-    if (TaskIDCounter > 1)
-    {                                      
-        UserTasks++ ;                                                       // Incrementa contator de tarefas de usuário ativas
-        queue_append ((queue_t **) &ReadyQueue, (queue_t *) task) ;         // Adiciona a fila de prontas
-    }
+#endif
 
-    task->id = (int) TaskIDCounter ;
-    task->state = READY ;
-    task->prio_static = 0 ;
-    task->prio_dinamic = 0 ;
-    task->processor_time = 0 ;
-    task->activations = 0 ;
-    task->start_time = systime() ;
 
-    #ifdef DEBUG
-        printf("PPOS: a tarefa %d foi criada pela tarefa %d\n", task->id, CurrentTask->id) ;
-    #endif
+// funções dispatcher/scheduler ==================================================
 
-    CoreFunctionAtivated = 0 ;
-    return (task->id) ;
+// Índice do balde onde fica uma tarefa de prioridade dinâmica prio na época atual
+int ready_slot (int prio)
+{
+    return (prio - PRIO_MIN + ReadyQueue.base) % PRIO_LEVELS ;
 }
 
-void task_exit (int exitCode)
+// Retorna a prioridade dinâmica de uma tarefa pronta, aplicando o envelhecimento
+// acumulado desde que ela foi definida (o envelhecimento é calculado sob demanda)
+int task_dinamic_prio (task_t *task)
 {
-    CoreFunctionAtivated = 1 ;                            // para evitar que funções de nucleo sofram preempção
+    int prio = task->prio_dinamic + ALPHA_AGING * (int) (ReadyQueue.epoch - task->prio_epoch) ;
 
-    #ifdef DEBUG
-        printf("PPOS: a tarefa %d será encerrada\n", task_id()) ;
-    #endif
+    if (prio < PRIO_MIN) prio = PRIO_MIN ;
+    else if (prio > PRIO_MAX) prio = PRIO_MAX ;
 
-    if (!CurrentTask)
+    return prio ;
+}
+
+// Operações sobre um balde da fila de prontas, nas duas representações (fila
+// circular encadeada ou deque, conforme READY_DEQUE)
+#if READY_DEQUE
+
+static inline task_t *bucket_first (int slot)
+{
+    return taskdq_first (&ReadyQueue.bucket[slot]) ;
+}
+
+static inline int bucket_append (int slot, task_t *task)
+{
+    return taskdq_push_back (&ReadyQueue.bucket[slot], task) ;
+}
+
+static inline int bucket_remove (int slot, task_t *task)
+{
+    return taskdq_remove (&ReadyQueue.bucket[slot], task) ;
+}
+
+// Junta o balde "from" na frente do balde "to", copiando o menor dos dois
+void bucket_merge (int from, int to)
+{
+    taskdq_t *old = &ReadyQueue.bucket[from], *new = &ReadyQueue.bucket[to] ;
+    taskdq_t swap ;
+    task_t *task ;
+
+    if (taskdq_count (new) <= taskdq_count (old))
     {
-        perror("Não é possível terminar tarefa vazia: ") ;
-        exit(1) ;
+        if (taskdq_concat (old, new) < 0)
+            perror ("Erro ao juntar baldes da fila de prontas: ") ;
+        swap = *old ;
+        *old = *new ;
+        *new = swap ;
+        return ;
     }
-    
-    CurrentTask->state = EXITED ;
-    CurrentTask->exit_time = systime () ;
-    CurrentTask->exit_code = exitCode ;
-    UserTasks-- ;
 
-    // Verifica a fila de tarefas que estão esperando e adiciona novamente na fila de prontas 
-    task_t *task ;
-    while (CurrentTask->join_queue)
+    while ((task = taskdq_last (old)))
     {
-        task = CurrentTask->join_queue ;
-        // Remove da fila da tarefa
-        queue_remove((queue_t **) &CurrentTask->join_queue, (queue_t *) CurrentTask->join_queue) ;
-        // Adiciona a fila de prontas
-        queue_append ((queue_t **) &ReadyQueue, (queue_t *) task) ; 
-        task->state = READY ;
+        taskdq_remove (old, task) ;
+        if (taskdq_push_front (new, task) < 0)
+        {
+            perror ("Erro ao juntar baldes da fila de prontas: ") ;
+            taskdq_push_back (old, task) ;
+            return ;
+        }
     }
+}
 
-    printf("Task %d exit: execution time %u ms, processor time %u ms, %u ativations\n",
-            CurrentTask->id, CurrentTask->exit_time - CurrentTask->start_time, CurrentTask->processor_time, CurrentTask->activations) ;
+#else
 
-    task_yield () ;
+static inline task_t *bucket_first (int slot)
+{
+    return ReadyQueue.bucket[slot] ;
 }
 
-int task_switch (task_t *task)
-{   
-    CoreFunctionAtivated = 1 ;                             // para evitar que funções de nucleo sofram preempção
+static inline int bucket_append (int slot, task_t *task)
+{
+    taskq_append (&ReadyQueue.bucket[slot], task) ;
+    return (0) ;
+}
 
-    if (!task)
+static inline int bucket_remove (int slot, task_t *task)
+{
+    return taskq_remove (&ReadyQueue.bucket[slot], task) ;
+}
+
+// Junta o balde "from" na frente do balde "to"
+void bucket_merge (int from, int to)
+{
+    taskq_concat (&ReadyQueue.bucket[from], &ReadyQueue.bucket[to]) ;
+    ReadyQueue.bucket[to] = ReadyQueue.bucket[from] ;
+    ReadyQueue.bucket[from] = NULL ;
+}
+
+#endif
+
+// Insere uma tarefa no final do balde correspondente a sua prioridade dinâmica
+void ready_insert (task_t *task)
+{
+    int slot ;
+
+    // o valor de referência do envelhecimento passa a ser a época atual; a
+    // prioridade herdada fora da fila de prontas (prio_inherit) vale a partir daqui
+    if (task->prio_inherited < task->prio_dinamic)
+        task->prio_dinamic = task->prio_inherited ;
+    task->prio_epoch = ReadyQueue.epoch ;
+    slot = ready_slot (task->prio_dinamic) ;
+
+    if (bucket_append (slot, task) < 0)
     {
-        perror (" Erro na criação troca de tarefas, task inválido: ") ;
-        exit (1) ;
+        perror ("Erro ao inserir tarefa na fila de prontas: ") ;
+        return ;
     }
+    ReadyQueue.bitmap |= 1ULL << slot ;
+    ReadyQueue.count++ ;
+}
 
-    #ifdef DEBUG
-        printf("PPOS: a tarefa %d será trocada pela tarefa %d\n", task_id(), task->id) ;
-    #endif
+// Retira uma tarefa da fila de prontas, guardando a prioridade dinâmica que ela tinha
+void ready_remove (task_t *task)
+{
+    int slot ;
 
-    CurrentTask->processor_time += systime () - ProcessorYieldTime ;    // acrescenta o tempo de processador para a tarefa que estava executando
-    ucontext_t *old_current_task = &CurrentTask->context ;              // usado para salvar o contexto que estava ocorrendo antes da troca
+    task->prio_dinamic = task_dinamic_prio (task) ;
+    task->prio_epoch = ReadyQueue.epoch ;
+    slot = ready_slot (task->prio_dinamic) ;
 
-    CurrentTask = task ;                                                // é preciso a mudar variável global antes de mudar de contexto
-    CurrentTask->activations++;                                         // aciona ativação da tarefa
+    if (bucket_remove (slot, task) < 0)
+        return ;
 
-    ProcessorYieldTime = systime ();                                    // guarda o momento que o processador foi entregue para a tarefa
-    TicksRemaining = QUANTUM_SIZE ;                                     // a tarefa recebera um quantum para executar
+    if (!bucket_first (slot))
+        ReadyQueue.bitmap &= ~(1ULL << slot) ;
+    ReadyQueue.count-- ;
+}
 
-    CoreFunctionAtivated = 0 ;
-    swapcontext (old_current_task, &task->context) ;
+// Acorda de uma vez todas as tarefas de uma fila de espera: a fila inteira é
+// emendada em ReadyQueue.wake, em tempo constante, e as tarefas só entram nos
+// baldes (cada uma na sua prioridade) na próxima decisão do escalonador
+void ready_wake_all (task_t **queue)
+{
+    taskq_concat (&ReadyQueue.wake, queue) ;
 
-    return (0) ;
+    #if TICKLESS
+    timer_program () ;                    // a tarefa atual pode ter ganhado concorrentes
+    #endif
 }
 
-// retorna o identificador da tarefa corrente (main deve ser 0)
-int task_id ()
+void wheel_insert (task_t *task) ;
+void wheel_start (task_t *task) ;
+void wheel_remove (task_t *task) ;
+
+// Coloca nos baldes as tarefas acordadas em bloco; as que esperavam com prazo
+// saem também da roda de tempo
+void ready_drain ()
 {
+    task_t *task ;
 
-    if (CurrentTask) 
-        return CurrentTask->id ;
-    
-    else
+    while ((task = taskq_pop_front (&ReadyQueue.wake)))
     {
-        perror("Erro ao adquirir ID da Tarefa: ") ;
-        return (-1) ;
+        if (task->wait_queue)
+        {
+            wheel_remove (task) ;
+            task->wait_queue = NULL ;
+        }
+        task->state = READY ;
+        ready_insert (task) ;
     }
 }
 
-// operações de escalonamento ==================================================
+// Prioridade de referência de uma tarefa: a estática, ou a herdada por meio de
+// um mutex, se esta for mais alta
+int task_base_prio (task_t *task)
+{
+    return task->prio_inherited < task->prio_static ? task->prio_inherited : task->prio_static ;
+}
 
-void task_yield ()
-{   
-    CoreFunctionAtivated = 1;             // para evitar que funções de nucleo sofram preempção
-    
-    #ifdef DEBUG
-        printf("PPOS: a tarefa %d passa o controle do processador\n", task_id()) ;
+// Prioridade com que a tarefa volta à fila de prontas ao ser escolhida: a de
+// referência ou, no MLFQ, a estática deslocada pelo nível (a herdada, se for
+// mais alta, continua valendo por inteiro)
+int task_sched_prio (task_t *task)
+{
+    #if SCHED_MLFQ
+    int prio = task->prio_static + task->sched_level * MLFQ_STEP ;
+
+    if (prio > PRIO_MAX) prio = PRIO_MAX ;
+    return task->prio_inherited < prio ? task->prio_inherited : prio ;
+    #else
+    return task_base_prio (task) ;
     #endif
-    
-    if (CurrentTask == &DispatcherTask)
-    {   // Dispatcher agora será a ultima tarefa, então ela que termina o programa.
-        exit(0) ;
+}
+
+#if SCHED_MLFQ
+// Muda o nível MLFQ de uma tarefa fora da fila de prontas (bloqueando ou já
+// retirada dela), ajustando a prioridade com que ela vai voltar
+void mlfq_set_level (task_t *task, int level)
+{
+    if (level < 0) level = 0 ;
+    else if (level >= MLFQ_LEVELS) level = MLFQ_LEVELS - 1 ;
+
+    task->sched_level = level ;
+    task->prio_dinamic = task_sched_prio (task) ;
+}
+
+// A cada MLFQ_BOOST_MS, todas as tarefas prontas voltam ao nível 0: as de
+// processamento longo que desceram até o último nível não ficam sem executar
+// enquanto houver tarefas interativas
+void mlfq_boost ()
+{
+    task_t *boosted = NULL, *task ;
+    int slot ;
+
+    if (clock_ticks () - MlfqBoostTime < (unsigned int) ms_ticks (MLFQ_BOOST_MS))
+        return ;
+    MlfqBoostTime = clock_ticks () ;
+
+    for (slot = 0; slot < PRIO_LEVELS; slot++)
+        while ((task = bucket_first (slot)))
+        {
+            ready_remove (task) ;
+            taskq_append (&boosted, task) ;
+        }
+
+    while ((task = taskq_pop_front (&boosted)))
+    {
+        mlfq_set_level (task, 0) ;
+        ready_insert (task) ;
     }
+}
+#endif
+
+// Faz "owner" herdar a prioridade "prio" de uma tarefa que passou a esperar por
+// um mutex dela; uma tarefa pronta muda de balde na hora. A prioridade dinâmica
+// de uma tarefa fora da fila de prontas não muda: bloqueada numa fila WAIT_PRIO,
+// ela fica na posição da prioridade com que bloqueou (a herança não a adianta
+// nessa fila), e a herdada passa a valer quando ela volta à fila de prontas.
+void prio_inherit (task_t *owner, int prio)
+{
+    if (prio >= owner->prio_inherited)
+        return ;
 
-    else
-    {  
-        task_switch(&DispatcherTask) ;
+    owner->prio_inherited = prio ;
+
+    if (owner->state == READY && owner != &DispatcherTask)
+    {
+        if (task_dinamic_prio (owner) <= prio)
+            return ;
+        ready_remove (owner) ;
+        owner->prio_dinamic = prio ;
+        ready_insert (owner) ;
     }
 }
 
-// define a prioridade estática de uma tarefa (ou a tarefa atual)
-void task_setprio (task_t *task, int prio)
+// Desfaz a herança de prioridade de uma tarefa que não detém mais mutexes; uma
+// tarefa pronta (como a corrente) muda de balde na hora e uma adormecida volta
+// com a prioridade recalculada. Uma tarefa bloqueada fica na posição em que está
+// na fila de espera e recebe a prioridade recalculada quando for escalonada.
+void prio_restore (task_t *task)
 {
-    // Corrige limites inferiores e superiores de prioridade
-    if (prio < -20) prio = -20 ;
-    else if (prio > 20) prio = 20 ;
+    task->prio_inherited = PRIO_MAX ;
 
-    if (task)
+    if (task->state == READY)
     {
-        #ifdef DEBUG
-            printf("task_setprio: priodidade estatica da tarefa %d = %d\n", task->id, prio) ;
-        #endif
-        task->prio_static = prio ;
-        task->prio_dinamic = prio ;
-        return ;
+        ready_remove (task) ;
+        task->prio_dinamic = task_sched_prio (task) ;
+        ready_insert (task) ;
     }
+    else if (task->state == SLEEPING)
+        task->prio_dinamic = task_sched_prio (task) ;
+}
 
-    if (CurrentTask)
+// Insere uma tarefa na fila de espera "queue" conforme a política da fila. Em
+// WAIT_PRIO a fila fica ordenada pela prioridade dinâmica que cada tarefa tinha
+// ao bloquear, e a chegada desempata: a busca parte do fim da fila, de forma
+// que a inserção entre iguais é O(1), e acordar a melhor tarefa continua sendo
+// retirar a primeira.
+void wait_insert (task_t **queue, int policy, task_t *task)
+{
+    task_t *pos ;
+
+    if (policy != WAIT_PRIO || !*queue || (*queue)->prev->prio_dinamic <= task->prio_dinamic)
     {
-        #ifdef DEBUG
-            printf("task_setprio: priodidade estatica da tarefa (corrente) %d = %d", task->id, prio) ;
-        #endif
-        CurrentTask->prio_static = prio ;
-        task->prio_dinamic = prio ;
+        taskq_append (queue, task) ;
         return ;
     }
 
-    perror("task_setprio: task e CurrentTask são nulas!") ;
-    exit (1) ;
+    // pos é a primeira tarefa do trecho final com prioridade pior que a de task
+    pos = (*queue)->prev ;
+    while (pos != *queue && pos->prev->prio_dinamic > task->prio_dinamic)
+        pos = pos->prev ;
+    taskq_insert_before (queue, pos, task) ;
 }
 
-// retorna a prioridade estática de uma tarefa (ou a tarefa atual)
-int task_getprio (task_t *task)
+// Bloqueia a tarefa corrente na fila de espera "queue", ordenada conforme
+// "policy", até ser acordada por wait_wake (resultado 0, ou o informado), em
+// bloco por ready_wake_all (-1, objeto destruído) ou, se ticks >= 0, pelo
+// vencimento do prazo (WAIT_TIMEOUT). Com prazo, a tarefa fica também na roda
+// de tempo, e quem a acordar primeiro a retira da outra estrutura em O(1); um
+// prazo além do alcance da roda fica nela em partes (wait_extra). Deve ser
+// chamada com a preempção desativada.
+int wait_block_policy (task_t **queue, int policy, long long ticks)
 {
-    if (task)
-    {
-        return task->prio_static ;
-    }
+    CurrentTask->wait_result = -1 ;
+    CurrentTask->wait_extra = 0 ;
+    ready_remove (CurrentTask) ;
+    #if SCHED_MLFQ
+    mlfq_set_level (CurrentTask, CurrentTask->sched_level - 1) ;
+    #endif
+    wait_insert (queue, policy, CurrentTask) ;
 
-    if (CurrentTask)
+    if (ticks >= 0)
     {
-        return CurrentTask->prio_static ;
+        if (ticks > SLEEP_MAX_TICKS)
+        {
+            CurrentTask->wait_extra = ticks - SLEEP_MAX_TICKS ;
+            ticks = SLEEP_MAX_TICKS ;
+        }
+        CurrentTask->awakening_time = clock_ticks () + (unsigned int) ticks ;
+        CurrentTask->wait_queue = queue ;
+        wheel_start (CurrentTask) ;
     }
+    CurrentTask->state = SUSPENDED ;
 
-    perror("task_getprio: task e CurrentTask são nulas!") ;
-    exit (1) ;
+    task_yield () ;
+
+    return CurrentTask->wait_result ;
 }
 
-// operações de sincronização ==================================================
+// Bloqueia a tarefa corrente numa fila de espera em ordem de chegada
+// Ticks que faltavam para o prazo da última espera da tarefa corrente quando ela
+// foi acordada (para quem volta a esperar pelo resto do prazo)
+long long wait_ticks_left ()
+{
+    int delta = (int) (CurrentTask->awakening_time - clock_ticks ()) ;
 
-// a tarefa corrente aguarda o encerramento de outra task
-int task_join (task_t *task)
+    return (long long) CurrentTask->wait_extra + (delta > 0 ? delta : 0) ;
+}
+
+int wait_block_timeout (task_t **queue, long long ticks)
+{
+    return wait_block_policy (queue, WAIT_FIFO, ticks) ;
+}
+
+int wait_block (task_t **queue)
 {
-    CoreFunctionAtivated = 1 ;
+    return wait_block_timeout (queue, -1) ;
+}
 
-    if (task == NULL) return -1 ;
-    if (CurrentTask == NULL) return -1 ;
-    if (task->state == EXITED)
+#if WAKE_AFFINE
+// Guarda a tarefa que a tarefa corrente acabou de acordar como candidata a
+// executar quando ela liberar o processador (task_yield). A candidata é a
+// primeira tarefa acordada desde a última decisão de escalonamento.
+void wake_affine (task_t *task)
+{
+    if (AffineTask || CurrentTask == &DispatcherTask ||
+        task_sched_prio (task) > task_sched_prio (CurrentTask))
+        return ;
+
+    AffineTask = task ;
+}
+#endif
+
+// Torna pronta uma tarefa já retirada de sua fila de espera, que recebe
+// "result" como resultado da espera
+void wait_ready (task_t *task, int result)
+{
+    if (task->wait_queue)
     {
-        #ifdef DEBUG
-            printf("task_join: A tarefa %d já está encerrada\n", task->id) ;
-        #endif
-        return task->exit_code ;
+        wheel_remove (task) ;
+        task->wait_queue = NULL ;
     }
+    task->wait_result = result ;
+    task->state = READY ;
+    ready_insert (task) ;
 
-    #ifdef DEBUG
-        printf("A tarefa %d solitou task_join() e está esperando a tarefa %d\n", CurrentTask->id, task->id) ;
+    #if WAKE_AFFINE
+    wake_affine (task) ;
     #endif
 
-    // Remove da fila de prontas
-    queue_remove((queue_t **) &ReadyQueue, (queue_t *) CurrentTask) ;
+    #if TICKLESS
+    timer_program () ;                    // a tarefa atual pode ter ganhado concorrentes
+    #endif
+}
+
+// Acorda a primeira tarefa da fila de espera "queue", que recebe "result" como
+// resultado da espera. Retorna a tarefa acordada, ou NULL se a fila está vazia.
+task_t *wait_wake (task_t **queue, int result)
+{
+    task_t *task = taskq_pop_front (queue) ;
+
+    if (task)
+        wait_ready (task, result) ;
+    return task ;
+}
+
+// Faz o envelhecimento de todas as tarefas prontas: avança a época, de forma que
+// cada balde passa a representar uma prioridade uma unidade menor. O balde que
+// estava em PRIO_MIN não pode mais envelhecer, então é juntado (antes) ao balde
+// que chega em PRIO_MIN; ele passa então a representar PRIO_MAX e fica vazio.
+void perform_task_aging ()
+{
+    int old_slot = ready_slot (PRIO_MIN) ;
+    int new_slot ;
 
-    // Adiciona a fila de join da tarefa
-    queue_append ((queue_t **) &task->join_queue, (queue_t *) CurrentTask) ; 
+    ReadyQueue.epoch++ ;
+    ReadyQueue.base = (ReadyQueue.base + 1) % PRIO_LEVELS ;
+    new_slot = ready_slot (PRIO_MIN) ;
 
-    task_yield() ;
+    if (!bucket_first (old_slot))
+        return ;
+
+    bucket_merge (old_slot, new_slot) ;
+    ReadyQueue.bitmap |= 1ULL << new_slot ;
+    ReadyQueue.bitmap &= ~(1ULL << old_slot) ;
 
-    return task->exit_code ;  
+    #ifdef DEBUG_PRIO
+        printf("PPOS: tarefas com prioridade %d juntadas na época %u\n", PRIO_MIN, ReadyQueue.epoch) ;
+    #endif
 }
 
-// suspende a tarefa corrente por t milissegundos
-void task_sleep (int t)
+// funções da roda de tempo ======================================================
+
+// Procura a primeira posição ocupada de um nível a partir de "from", dando a
+// volta no nível se necessário. Retorna -1 se o nível está vazio.
+int wheel_find (unsigned long long *bitmap, int from)
 {
-    CoreFunctionAtivated = 1 ;
+    int word = from / 64 ;
+    unsigned long long bits = bitmap[word] & (~0ULL << (from % 64)) ;
+    int i ;
 
-    if (t < 0)
+    for (i = 0; i <= WHEEL_SLOTS / 64; i++)
     {
-        perror("task_sleep: Valor de t inválido") ;
+        if (bits)
+            return (word * 64 + __builtin_ctzll (bits)) % WHEEL_SLOTS ;
+
+        word = (word + 1) % (WHEEL_SLOTS / 64) ;
+        bits = bitmap[word] ;
+    }
+    return -1 ;
+}
+
+// Coloca uma tarefa na roda de tempo, no nível que cobre seu tempo de espera
+void wheel_insert (task_t *task)
+{
+    unsigned int deadline = task->awakening_time ;
+    unsigned int delta ;
+    int level, pos ;
+
+    // prazo já vencido: acorda no próximo tick processado
+    if ((int) (deadline - SleepingWheel.time) < 0)
+        deadline = SleepingWheel.time ;
+
+    delta = deadline - SleepingWheel.time ;
+    for (level = 0; level < WHEEL_LEVELS - 1; level++)
+        if (delta < 1U << (WHEEL_BITS * (level + 1)))
+            break ;
+
+    pos = (deadline >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1) ;
+    task->wheel_slot = level * WHEEL_SLOTS + pos ;
+
+    timerq_append (&SleepingWheel.slot[level][pos], task) ;
+    SleepingWheel.bitmap[level][pos / 64] |= 1ULL << (pos % 64) ;
+    SleepingWheel.count++ ;
+}
+
+// Coloca na roda de tempo uma tarefa que começa a esperar; com a roda vazia, o
+// relógio dela (que só avança quando há tarefas a acordar) pode estar muito
+// atrasado, o que encurtaria o alcance do prazo, então ele é acertado antes
+void wheel_start (task_t *task)
+{
+    if (!SleepingWheel.count)
+        SleepingWheel.time = clock_ticks () ;
+    wheel_insert (task) ;
+}
+
+// Retira uma tarefa da roda de tempo (cancela a espera)
+void wheel_remove (task_t *task)
+{
+    int level = task->wheel_slot / WHEEL_SLOTS ;
+    int pos = task->wheel_slot % WHEEL_SLOTS ;
+
+    if (timerq_remove (&SleepingWheel.slot[level][pos], task) < 0)
         return ;
+
+    if (!SleepingWheel.slot[level][pos])
+        SleepingWheel.bitmap[level][pos / 64] &= ~(1ULL << (pos % 64)) ;
+    SleepingWheel.count-- ;
+}
+
+// Redistribui as tarefas de uma posição de um nível superior nos níveis abaixo
+void wheel_cascade (int level, int pos)
+{
+    task_t *task ;
+
+    while ((task = SleepingWheel.slot[level][pos]))
+    {
+        wheel_remove (task) ;
+        wheel_insert (task) ;
     }
+}
 
-    if (CurrentTask == NULL)
+// Informa o tick em que a próxima tarefa adormecida deve acordar
+int wheel_next_deadline (unsigned int *t)
+{
+    unsigned int best = 0, time = SleepingWheel.time ;
+    int found = 0, level, pos, from ;
+    task_t *task ;
+
+    if (!SleepingWheel.count)
+        return (-1) ;
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
     {
-        perror("task_sleep: Valor de CurrentTask inválida") ;
-        return ;
+        // no nível 0 a posição corrente ainda pode ter tarefas; nos demais ela
+        // guarda a volta seguinte do nível, então é a última a ser considerada
+        from = (time >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1) ;
+        if (level > 0)
+            from = (from + 1) % WHEEL_SLOTS ;
+
+        pos = wheel_find (SleepingWheel.bitmap[level], from) ;
+        if (pos < 0)
+            continue ;
+
+        // no nível 0 todas as tarefas de uma posição vencem no mesmo instante
+        task = SleepingWheel.slot[level][pos] ;
+        do
+        {
+            if (!found || (int) (task->awakening_time - best) < 0)
+                best = task->awakening_time ;
+            found = 1 ;
+            task = task->timer_next ;
+        } while (level > 0 && task != SleepingWheel.slot[level][pos]) ;
+
+        // qualquer tarefa na parte não processada do nível 0 vence antes
+        // das tarefas dos níveis superiores
+        if (level == 0 && pos >= from)
+            break ;
     }
 
-    #ifdef DEBUG
-        printf("A tarefa %d dormirá por %d\n", CurrentTask->id, t) ;
-    #endif
+    // prazos já vencidos ainda não processados
+    if ((int) (best - time) < 0)
+        best = time ;
 
-    // Remove da fila de prontas
-    queue_remove((queue_t **) &ReadyQueue, (queue_t *) CurrentTask) ; 
+    *t = best ;
+    return (0) ;
+}
+
+// Informa o instante (em milisegundos) em que a próxima tarefa adormecida deve acordar
+int task_next_wakeup (unsigned int *t)
+{
+    unsigned int deadline ;
+    int delta ;
+
+    if (wheel_next_deadline (&deadline) < 0)
+        return (-1) ;
+
+    // converte a distância até o prazo, arredondando para cima
+    delta = (int) (deadline - clock_ticks ()) ;
+    if (delta < 0)
+        delta = 0 ;
+
+    *t = systime () + (unsigned int) (((long long) delta * TICK_USEC + 999) / 1000) ;
+    return (0) ;
+}
+
+// Distância (em ticks) de "time" até o próximo tick em que algo acontece na roda:
+// uma posição ocupada do nível 0 ou uma cascata que traga tarefas para baixo.
+// Se um nível está vazio, nada acontece antes de ele completar a volta corrente,
+// então a busca continua no nível de cima (o que importa com ticks de 1 us)
+unsigned long long wheel_next_event (unsigned int time)
+{
+    int level, shift = 0, cur = 0, hit ;
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+    {
+        shift = WHEEL_BITS * level ;
+        cur = (time >> shift) & (WHEEL_SLOTS - 1) ;
+        hit = wheel_find (SleepingWheel.bitmap[level], (cur + 1) % WHEEL_SLOTS) ;
+
+        // início de uma posição seguinte, na mesma volta do nível
+        if (hit > cur)
+            return ((unsigned long long) (hit - cur) << shift) - (time & ((1ULL << shift) - 1)) ;
 
-    // Adiciona na fila de dormentes
-    queue_append ((queue_t **) &SleepingQueue, (queue_t *) CurrentTask) ; 
+        // só há tarefas depois da volta: para no fim da volta corrente
+        if (hit >= 0)
+            break ;
+    }
+
+    return ((unsigned long long) (WHEEL_SLOTS - cur) << shift) - (time & ((1ULL << shift) - 1)) ;
+}
+
+// Verifica se está na hora e acorda as tarefas que precisam ser acordadas;
+// o custo é proporcional às tarefas que acordam (e às cascatas), não ao total
+// de tarefas adormecidas
+void perform_task_awakening ()
+{
+    unsigned int now = clock_ticks () ;
+    unsigned int next ;
+    unsigned long long step ;
+    int pos, level ;
+    task_t *task ;
+
+    // tarefas acordadas em bloco ainda podem estar na roda de tempo
+    ready_drain () ;
 
-    // Calcula o momento que a tarefa deve acordar
-    CurrentTask->awakening_time = systime () + t ;
+    // o tick "now" continua sendo o corrente, pois tarefas ainda podem dormir
+    // até ele (task_sleep (0)); os ticks anteriores já foram processados
+    for (;;)
+    {
+        if (!SleepingWheel.count)
+        {
+            SleepingWheel.time = now ;
+            return ;
+        }
+
+        // Acorda as tarefas cujo prazo é o tick corrente
+        pos = SleepingWheel.time & (WHEEL_SLOTS - 1) ;
+        while ((task = SleepingWheel.slot[0][pos]))
+        {
+            wheel_remove (task) ;
 
-    CurrentTask->state = SLEEPING ;
-    task_yield() ;
-}
\ No newline at end of file
+            // espera com prazo vencido: sai também da fila de espera; se o
+            // prazo passa do alcance da roda, volta a ela com a parte seguinte
+            if (task->wait_queue && task->wait_extra)
+            {
+                step = task->wait_extra > SLEEP_MAX_TICKS ? SLEEP_MAX_TICKS : task->wait_extra ;
+                task->wait_extra -= step ;
+                task->awakening_time += (unsigned int) step ;
+                wheel_insert (task) ;
+                continue ;
+            }
+            if (task->wait_queue)
+            {
+                taskq_remove (task->wait_queue, task) ;
+                task->wait_queue = NULL ;
+                task->wait_result = WAIT_TIMEOUT ;
+            }
+            task->state = READY ;
+
+            // Adiciona na fila de prontas
+            ready_insert (task) ;
+        }
+
+        if (SleepingWheel.time == now)
+            return ;
+
+        // pula direto para o próximo tick em que algo acontece na roda, sem
+        // passar tick a tick (nem volta a volta) pelas posições vazias
+        step = wheel_next_event (SleepingWheel.time) ;
+        if (step > now - SleepingWheel.time)
+            next = now ;
+        else
+            next = SleepingWheel.time + (unsigned int) step ;
+
+        SleepingWheel.time = next ;
+
+        // completou uma volta do nível 0: faz a cascata dos níveis superiores
+        if (!(next & (WHEEL_SLOTS - 1)))
+        {
+            for (level = 1; level < WHEEL_LEVELS; level++)
+            {
+                int upper = (next >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1) ;
+                wheel_cascade (level, upper) ;
+                if (upper)
+                    break ;
+            }
+        }
+    }
+}
+
+// Primeira tarefa do balde de maior prioridade da fila de prontas (não vazia)
+task_t *ready_best ()
+{
+    const unsigned long long all_slots = (1ULL << PRIO_LEVELS) - 1 ;
+    unsigned long long rotated ;
+    int base, slot ;
+
+    // gira o bitmap para que o bit 0 seja o balde de PRIO_MIN e procura o
+    // primeiro balde ocupado; dentro do balde a ordem é FIFO
+    base = ReadyQueue.base ;
+    rotated = ((ReadyQueue.bitmap >> base) | (ReadyQueue.bitmap << (PRIO_LEVELS - base))) & all_slots ;
+    slot = (__builtin_ctzll (rotated) + base) % PRIO_LEVELS ;
+    return bucket_first (slot) ;
+}
+
+#if SCHED_MLFQ
+// Depois de acordar tarefas adormecidas: se alguma pronta tem prioridade maior
+// que a da tarefa atual, marca a preempção, que não conta como quantum gasto
+void mlfq_preempt_check ()
+{
+    // com o quantum já vencido, a preempção conta como quantum gasto
+    if (PreemptPending || CurrentTask == &DispatcherTask || CurrentTask->state != READY
+        || !ReadyQueue.count)
+        return ;
+
+    if (task_dinamic_prio (ready_best ()) < task_dinamic_prio (CurrentTask))
+    {
+        WakePreempt = 1 ;
+        PreemptPending = 1 ;
+    }
+}
+
+#if !TICKLESS
+// Trata um tick com tarefas adormecidas, com a preempção ativada: acorda as
+// que venceram e confere se alguma deve tomar o processador
+void mlfq_wakeup ()
+{
+    preempt_disable () ;
+
+    WakePending = 0 ;
+    perform_task_awakening () ;
+    mlfq_preempt_check () ;
+
+    PreemptDisabled-- ;
+}
+#endif
+#endif
+
+// Faz o escalonamento de tarefas
+task_t* scheduler()
+{
+    ready_drain () ;
+
+    if (!ReadyQueue.count)
+    {
+        #if WAKE_AFFINE
+        AffineTask = NULL ;
+        AffineTicks = 0 ;
+        #endif
+        perform_task_awakening () ;
+        return NULL ;
+    }
+
+    task_t* prio_task ;         // Higher priority task, tarefa com maior prioridade
+
+    #if SCHED_MLFQ
+    mlfq_boost () ;
+    #else
+    perform_task_aging () ;
+    #endif
+    perform_task_awakening () ;
+
+    prio_task = ready_best () ;
+
+    #if WAKE_AFFINE
+    // a tarefa acordada passa à frente se há quantum a doar e nenhuma pronta
+    // tem prioridade estática melhor; o envelhecimento das outras não conta,
+    // pois o tempo doado seria de qualquer forma da tarefa que a acordou
+    if (AffineTask)
+    {
+        if (AffineTicks && AffineTask->state == READY &&
+            task_sched_prio (AffineTask) <= task_sched_prio (prio_task))
+            prio_task = AffineTask ;
+        else
+            AffineTicks = 0 ;
+        AffineTask = NULL ;
+    }
+    #endif
+
+    // A tarefa de maior prioridade recebe sua prioridade estática (ou a herdada)
+    ready_remove (prio_task) ;
+    prio_task->prio_dinamic = task_sched_prio (prio_task) ;
+    ready_insert (prio_task) ;
+
+    return prio_task ;
+}
+
+// Libera as estruturas usadas nas tarefa
+int free_task_structures (task_t *task) {
+    if (!task)
+    {
+        perror ("Erro, task inválido: ") ;
+        return (-2) ;
+    }
+
+    #ifdef DEBUG
+        printf("Vou free() a task %d\n", task->id) ;
+    #endif
+
+    if (task->stack_group)
+    {
+        // o conteúdo da pilha compartilhada não precisa mais ser guardado
+        if (task->stack_group->owner == task)
+            task->stack_group->owner = NULL ;
+        task->stack_group->tasks-- ;
+        task->stack_group = NULL ;
+
+        free (task->stack_save) ;
+        task->stack_save = NULL ;
+        task->stack_save_size = 0 ;
+    }
+    else if (task->stack_mapped)
+        stack_free (task->stack, stack_class (task->stack_size)) ;
+    else
+        free (task->stack) ;
+    task->stack = NULL ;
+
+    #ifdef DEBUG
+        printf("PPOS: Free() aconteceu com sucesso\n") ;
+    #endif
+
+    return (0);
+}
+
+// Sem tarefas prontas: suspende o processo até chegar um sinal (o tick, ou no
+// modo tickless o disparo programado para a próxima tarefa adormecida), em vez
+// de ficar chamando o scheduler em espera ocupada
+void dispatcher_idle ()
+{
+    sigset_t alarm, mask ;
+    unsigned int idle_start ;
+
+    // com o SIGALRM bloqueado, um disparo ocorrido depois da verificação
+    // abaixo fica pendente e encerra o sigsuspend, então não é perdido
+    sigemptyset (&alarm) ;
+    sigaddset (&alarm, SIGALRM) ;
+    sigprocmask (SIG_BLOCK, &alarm, &mask) ;
+
+    ready_drain () ;
+    perform_task_awakening () ;
+    if (!ReadyQueue.count)
+    {
+        #if TICKLESS
+        timer_program () ;
+        #endif
+
+        #ifdef DEBUG
+            printf("PPOS: dispatcher ocioso em %u ms\n", systime ()) ;
+        #endif
+
+        idle_start = systime () ;
+        sigdelset (&mask, SIGALRM) ;
+        sigsuspend (&mask) ;
+
+        // o tempo ocioso não é tempo de processador do dispatcher
+        ProcessorYieldTime += systime () - idle_start ;
+    }
+
+    sigprocmask (SIG_UNBLOCK, &alarm, NULL) ;
+}
+
+// Faz o controle geral do programa
+void dispatcher ()
+{
+    // o dispatcher roda sempre dentro do núcleo
+    preempt_disable () ;
+
+    task_t* next ;
+
+    while (1)
+    {
+        // Trata a tarefa que devolveu o processador ao dispatcher
+        if (PreviousTask)
+        {
+            switch (PreviousTask->state)
+            {
+                case READY:
+                    break;
+
+                case EXITED:
+                    // Libera estruturas (a tarefa já saiu da fila de prontas)
+                    free_task_structures(PreviousTask) ;
+                    break ;
+                
+                case SUSPENDED:
+                    // A tarefa se bloqueou (task_join)
+                    break ;
+
+                case SLEEPING:
+                    break ;
+
+                default:
+                    perror("Estado da tarefa está inválido.") ;
+                    exit (1) ;
+            }
+            PreviousTask = NULL ;
+        }
+
+        if (UserTasks <= 0)
+            break ;
+
+        #if TICKLESS
+        // um disparo ocorrido no dispatcher fica tratado aqui: o scheduler acorda
+        // as tarefas vencidas e a troca de contexto (ou dispatcher_idle)
+        // programa o próximo disparo
+        TimerPending = 0 ;
+        #endif
+
+        next = scheduler() ;
+        if (next)
+            task_switch(next) ;
+        else
+            dispatcher_idle () ;
+    }
+    task_exit (0) ; 
+}
+
+
+// funções gerais ==============================================================
+
+void ppos_init ()
+{
+    // desativa o buffer da saida padrao (stdout), usado pela função printf 
+    setvbuf (stdout, 0, _IONBF, 0) ;
+
+    // definições das variávies globais
+    TaskIDCounter = 0 ;
+    UserTasks = 0 ;                        
+    ReadyQueue = (ready_queue_t) {0} ;
+    SleepingWheel = (timer_wheel_t) {0} ;
+    PreemptDisabled = 0 ;
+    PreemptPending = 0 ;
+    PageSize = (size_t) sysconf (_SC_PAGESIZE) ;
+    #if TICKLESS
+    clock_gettime (CLOCK_MONOTONIC, &ClockOrigin) ;        // o relógio começa em 0
+    #endif
+    preempt_disable () ;
+    
+    // Configuração da tarefa principal: ela usa a pilha do processo e seu
+    // contexto é salvo na primeira troca
+    MainTask.stack = NULL ;
+    MainTask.stack_size = 0 ;
+    #ifdef SWITCH_SIGMASK
+    sigprocmask (SIG_SETMASK, NULL, &MainTask.sigmask) ;
+    #endif
+
+    MainTask.id = (int) TaskIDCounter ;
+    MainTask.prio_inherited = PRIO_MAX ;
+    MainTask.sched_level = 0 ;
+    MainTask.prev = NULL ;
+    MainTask.next = NULL ;
+
+    CurrentTask = &MainTask ;
+    MainTask.state = READY ;
+
+    UserTasks++ ;                                                               // Incrementa contator de tarefas de usuário ativas
+    ready_insert (&MainTask) ;                                                  // Adiciona a fila de prontas
+
+    // =================================================
+
+    // Criação do Dispatcher (tarefa 1)
+    task_create (&DispatcherTask, dispatcher, "dispatcher") ;
+
+    // Configuração de sinais e tempo:
+    // registra a ação para o sinal de timer SIGALRM
+    TicksTimer = 0 ;
+    ProcessorYieldTime = 0 ;
+
+    action.sa_handler = handler ;
+    sigemptyset (&action.sa_mask) ;
+    action.sa_flags = 0 ;
+    if (sigaction (SIGALRM, &action, 0) < 0)
+    {
+        perror ("Erro em sigaction: ") ;
+        exit (1) ;
+    }
+
+    #if TICKLESS
+    // cria o temporizador de disparo único, que gera SIGALRM; ele só é
+    // programado quando há um evento pendente (timer_program)
+    struct sigevent event = {0} ;
+
+    TimerArmed = 0 ;
+    TimerPending = 0 ;
+    event.sigev_notify = SIGEV_SIGNAL ;
+    event.sigev_signo = SIGALRM ;
+    if (timer_create (CLOCK_MONOTONIC, &event, &OneShotTimer) < 0)
+    {
+        perror ("Erro em timer_create: ") ;
+        exit (1) ;
+    }
+
+    #ifdef PR_SET_TIMERSLACK
+    // sem a folga padrão do Linux (50 us), que atrasaria todo disparo
+    prctl (PR_SET_TIMERSLACK, 1UL) ;
+    #endif
+    #else
+    // ajusta valores do temporizador
+    timer.it_value.tv_usec = 1000 ;             // primeiro disparo, em micro-segundos
+    timer.it_value.tv_sec  = 0 ;                // primeiro disparo, em segundos
+    timer.it_interval.tv_usec = 1000 ;          // disparos subsequentes, em micro-segundos
+    timer.it_interval.tv_sec  = 0 ;             // disparos subsequentes, em segundos
+
+    // arma o temporizador ITIMER_REAL (vide man setitimer)
+    if (setitimer (ITIMER_REAL, &timer, 0) < 0)
+    {
+        perror ("Erro em setitimer: ") ;
+        exit (1) ;
+    }
+    #endif
+
+    #ifdef DEBUG
+    printf ("PPOS: Ping Pong OS inicializado\n") ;
+    #endif
+
+    preempt_enable () ;
+    task_yield () ;
+}
+
+// gerência de tarefas =========================================================
+
+int task_create (task_t *task, void (*start_func)(void *), void *arg)
+{
+    return task_create_attr (task, start_func, arg, NULL) ;
+}
+
+int task_create_attr (task_t *task, void (*start_func)(void *), void *arg, const task_attr_t *attr)
+{
+    size_t stack_size = STACKSIZE ;
+    int class ;
+
+    if (!task)
+    {
+        perror ("Erro na criação de nova tarefa, task inválido: ") ;
+        return (-2) ;
+    }
+
+    if (!start_func)
+    {
+        perror ("Erro na criação de nova tarefa, start_func inválido: ") ;
+        return (-3) ;
+    }
+
+    preempt_disable () ;                                  // para evitar que funções de nucleo sofram preempção
+
+    // Faz a configuração do contexto da tarefa
+    char *stack ;
+
+    task->prev = task->next = NULL ;
+    task->timer_prev = task->timer_next = NULL ;
+    task->wait_queue = NULL ;
+    task->stack_group = NULL ;
+    task->stack_save = NULL ;
+    task->stack_saved = 0 ;
+    task->stack_save_size = 0 ;
+
+    #ifdef NATIVE_SWITCH
+    if (attr && attr->stack_group)
+    {
+        // a pilha inicial é montada na área de salvamento e copiada para a
+        // pilha compartilhada na primeira ativação da tarefa
+        stack_group_t *group = attr->stack_group ;
+        size_t frame = CONTEXT_FRAME * sizeof (uint64_t) ;
+
+        if (!group->stack)
+        {
+            perror ("Erro na criação de nova tarefa, grupo de pilha inválido: ") ;
+            preempt_enable () ;
+            return (-4) ;
+        }
+
+        task->stack_save = malloc (STACK_SAVE_ALIGN) ;
+        if (!task->stack_save)
+        {
+            perror ("Erro na criação da pilha: ") ;
+            preempt_enable () ;
+            return (-1) ;
+        }
+        task->stack_save_size = STACK_SAVE_ALIGN ;
+        task->stack_saved = frame ;
+        context_prepare (task->stack_save, frame, task_bootstrap) ;
+
+        task->stack_group = group ;
+        task->stack = NULL ;
+        task->stack_mapped = 0 ;
+        task->stack_size = group->size ;
+        task->context = (char *) group->stack + group->size - frame ;
+        group->tasks++ ;
+    }
+    else
+    #else
+    if (attr && attr->stack_group)
+    {
+        perror ("Erro na criação de nova tarefa, pilha compartilhada requer a troca de contexto nativa: ") ;
+        preempt_enable () ;
+        return (-4) ;
+    }
+    else
+    #endif
+    {
+        if (attr && attr->stack_size)
+            stack_size = attr->stack_size ;
+
+        class = stack_class (stack_size) ;
+        stack_size = (size_t) 1 << class ;
+
+        // cada pilha com guarda ocupa dois mapeamentos, e o núcleo limita a
+        // quantidade deles (vm.max_map_count, em torno de 32 mil pilhas);
+        // acima disso as pilhas vêm do heap, sem página de guarda
+        stack = stack_alloc (class) ;
+        task->stack_mapped = 1 ;
+        if (!stack)
+        {
+            stack = malloc (stack_size) ;
+            task->stack_mapped = 0 ;
+        }
+        if (!stack)
+        {
+          perror ("Erro na criação da pilha: ") ;
+          preempt_enable () ;
+          return (-1) ;
+        }
+
+        task->stack = stack ;
+        task->stack_size = stack_size ;
+    }
+
+    task->start_func = start_func ;
+    task->start_arg = arg ;
+
+    #ifdef NATIVE_SWITCH
+    if (!task->stack_group)
+        task->context = context_prepare (stack, stack_size, task_bootstrap) ;
+    #else
+    getcontext (&task->context) ;
+    task->context.uc_stack.ss_sp = stack ;
+    task->context.uc_stack.ss_size = stack_size ;
+    task->context.uc_stack.ss_flags = 0 ;
+    task->context.uc_link = 0 ;
+    makecontext (&task->context, task_bootstrap, 0) ;
+    #endif
+
+    #ifdef SWITCH_SIGMASK
+    sigprocmask (SIG_SETMASK, NULL, &task->sigmask) ;
+    #endif
+
+    TaskIDCounter++ ;                       // Incrementa contatos de IDs           
+
+    task->id = (int) TaskIDCounter ;
+    task->state = READY ;
+    task->prio_static = 0 ;
+    task->prio_dinamic = 0 ;
+    task->prio_inherited = PRIO_MAX ;
+    task->mutexes_held = 0 ;
+    task->sched_level = 0 ;
+    task->processor_time = 0 ;
+    task->activations = 0 ;
+    task->start_time = systime() ;
+
+    // Se não for tarefa main ou o dispatcher:
+    if (TaskIDCounter > 1)
+    {                                      
+        UserTasks++ ;                                                       // Incrementa contator de tarefas de usuário ativas
+        ready_insert (task) ;                                               // Adiciona a fila de prontas
+
+        #if TICKLESS
+        timer_program () ;                                                  // a tarefa atual passa a ter concorrente
+        #endif
+    }
+
+    #ifdef DEBUG
+        printf("PPOS: a tarefa %d foi criada pela tarefa %d\n", task->id, CurrentTask->id) ;
+    #endif
+
+    preempt_enable () ;
+    return (task->id) ;
+}
+
+void task_exit (int exitCode)
+{
+    preempt_disable () ;                                  // para evitar que funções de nucleo sofram preempção
+
+    #ifdef DEBUG
+        printf("PPOS: a tarefa %d será encerrada\n", task_id()) ;
+    #endif
+
+    if (!CurrentTask)
+    {
+        perror("Não é possível terminar tarefa vazia: ") ;
+        exit(1) ;
+    }
+    
+    CurrentTask->state = EXITED ;
+    CurrentTask->exit_time = systime () ;
+    CurrentTask->exit_code = exitCode ;
+    UserTasks-- ;
+
+    // Remove da fila de prontas
+    if (CurrentTask != &DispatcherTask)
+        ready_remove (CurrentTask) ;
+
+    // Acorda de uma vez as tarefas que estão esperando por ela
+    #if WAKE_AFFINE
+    if (CurrentTask->join_queue)
+        wake_affine (CurrentTask->join_queue) ;
+    #endif
+    ready_wake_all (&CurrentTask->join_queue) ;
+
+    printf("Task %d exit: execution time %u ms, processor time %u ms, %u ativations\n",
+            CurrentTask->id, CurrentTask->exit_time - CurrentTask->start_time, CurrentTask->processor_time, CurrentTask->activations) ;
+
+    task_yield () ;
+}
+
+int task_switch (task_t *task)
+{   
+    int preempt_disabled ;
+    unsigned int now ;
+
+    if (!task)
+    {
+        perror (" Erro na criação troca de tarefas, task inválido: ") ;
+        exit (1) ;
+    }
+
+    preempt_disable () ;                                   // para evitar que funções de nucleo sofram preempção
+
+    #ifdef DEBUG
+        printf("PPOS: a tarefa %d será trocada pela tarefa %d\n", task_id(), task->id) ;
+    #endif
+
+    now = systime () ;
+    CurrentTask->processor_time += now - ProcessorYieldTime ;           // acrescenta o tempo de processador para a tarefa que estava executando
+    task_t *old_current_task = CurrentTask ;                            // usado para salvar o contexto que estava ocorrendo antes da troca
+
+    PreviousTask = CurrentTask ;
+    CurrentTask = task ;                                                // é preciso a mudar variável global antes de mudar de contexto
+    CurrentTask->activations++;                                         // aciona ativação da tarefa
+
+    ProcessorYieldTime = now ;                                          // guarda o momento que o processador foi entregue para a tarefa
+    quantum_start () ;                                                  // a tarefa recebera um quantum para executar
+
+    #ifdef SWITCH_SIGMASK
+    // troca também a máscara de sinais (custa uma chamada de sistema)
+    sigprocmask (SIG_SETMASK, &task->sigmask, &old_current_task->sigmask) ;
+    #endif
+
+    // a profundidade das seções críticas é de cada tarefa: fica guardada na
+    // pilha dela durante a troca e é restaurada quando ela volta a executar
+    preempt_disabled = PreemptDisabled ;
+    #ifdef NATIVE_SWITCH
+    if (task->stack_group && task->stack_group->owner != task)
+    {
+        // a pilha compartilhada tem o conteúdo de outra tarefa (talvez o da
+        // própria tarefa que sai): a troca passa pelo copiador
+        CopyTarget = task ;
+        context_switch (&old_current_task->context, CopierContext) ;
+    }
+    else
+        context_switch (&old_current_task->context, task->context) ;
+    #else
+    swapcontext (&old_current_task->context, &task->context) ;
+    #endif
+    PreemptDisabled = preempt_disabled ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// retorna o identificador da tarefa corrente (main deve ser 0)
+int task_id ()
+{
+
+    if (CurrentTask) 
+        return CurrentTask->id ;
+    
+    else
+    {
+        perror("Erro ao adquirir ID da Tarefa: ") ;
+        return (-1) ;
+    }
+}
+
+// operações de escalonamento ==================================================
+
+void task_yield ()
+{   
+    preempt_disable () ;                  // para evitar que funções de nucleo sofram preempção
+    
+    #ifdef DEBUG
+        printf("PPOS: a tarefa %d passa o controle do processador\n", task_id()) ;
+    #endif
+    
+    if (CurrentTask == &DispatcherTask)
+    {   // Dispatcher agora será a ultima tarefa, então ela que termina o programa.
+        exit(0) ;
+    }
+
+    #if SCHED_MLFQ
+    // o handler marcou o fim do quantum (PreemptPending) e a tarefa continua
+    // pronta: ela usou o quantum inteiro e desce um nível
+    if (PreemptPending && !WakePreempt && CurrentTask->state == READY)
+    {
+        ready_remove (CurrentTask) ;
+        mlfq_set_level (CurrentTask, CurrentTask->sched_level + 1) ;
+        ready_insert (CurrentTask) ;
+    }
+    #endif
+
+    #if WAKE_AFFINE
+    // o que resta do quantum pode ser doado à tarefa que ela acordou
+    if (AffineTask)
+    {
+        #if TICKLESS
+        int remaining = (int) (QuantumDeadline - clock_ticks ()) ;
+        #else
+        int remaining = TicksRemaining ;
+        #endif
+        AffineTicks = remaining > 0 ? remaining : 0 ;
+    }
+    #endif
+
+    #if DIRECT_SWITCH
+    // Escalona aqui mesmo e troca direto para a próxima tarefa; uma tarefa
+    // encerrada ainda precisa do dispatcher para liberar sua pilha
+    if (CurrentTask->state != EXITED)
+    {
+        task_t *next = scheduler () ;
+
+        if (next == CurrentTask)
+        {
+            // a própria tarefa foi escolhida: recebe um novo quantum
+            CurrentTask->activations++ ;
+            quantum_start () ;
+            preempt_enable () ;
+            return ;
+        }
+
+        if (next)
+        {
+            task_switch (next) ;
+            preempt_enable () ;
+            return ;
+        }
+    }
+    #endif
+
+    task_switch(&DispatcherTask) ;
+    preempt_enable () ;
+}
+
+// define a prioridade estática de uma tarefa (ou a tarefa atual)
+void task_setprio (task_t *task, int prio)
+{
+    // Corrige limites inferiores e superiores de prioridade
+    if (prio < PRIO_MIN) prio = PRIO_MIN ;
+    else if (prio > PRIO_MAX) prio = PRIO_MAX ;
+
+    if (!task)
+        task = CurrentTask ;
+
+    if (!task)
+    {
+        perror("task_setprio: task e CurrentTask são nulas!") ;
+        exit (1) ;
+    }
+
+    #ifdef DEBUG
+        printf("task_setprio: priodidade estatica da tarefa %d = %d\n", task->id, prio) ;
+    #endif
+
+    preempt_disable () ;
+
+    // Uma tarefa pronta precisa mudar de balde na fila de prontas
+    if (task->state == READY && task != &DispatcherTask)
+    {
+        ready_remove (task) ;
+        task->prio_static = prio ;
+        task->prio_dinamic = task_sched_prio (task) ;
+        ready_insert (task) ;
+    }
+    else
+    {
+        task->prio_static = prio ;
+        task->prio_dinamic = task_sched_prio (task) ;
+    }
+
+    preempt_enable () ;
+}
+
+// retorna a prioridade estática de uma tarefa (ou a tarefa atual)
+int task_getprio (task_t *task)
+{
+    if (task)
+    {
+        return task->prio_static ;
+    }
+
+    if (CurrentTask)
+    {
+        return CurrentTask->prio_static ;
+    }
+
+    perror("task_getprio: task e CurrentTask são nulas!") ;
+    exit (1) ;
+}
+
+// operações de sincronização ==================================================
+
+// a tarefa corrente aguarda o encerramento de outra task
+// Espera o fim de "task" por até "ticks" ticks do relógio (ticks < 0: sem prazo);
+// retorna 0 e o código de encerramento em *exit_code, -1 ou WAIT_TIMEOUT
+int join_ticks (task_t *task, long long ticks, int *exit_code)
+{
+    if (task == NULL) return -1 ;
+    if (CurrentTask == NULL) return -1 ;
+
+    preempt_disable () ;
+
+    if (task->state == EXITED)
+    {
+        #ifdef DEBUG
+            printf("task_join: A tarefa %d já está encerrada\n", task->id) ;
+        #endif
+        *exit_code = task->exit_code ;
+        preempt_enable () ;
+        return (0) ;
+    }
+
+    #ifdef DEBUG
+        printf("A tarefa %d solitou task_join() e está esperando a tarefa %d\n", CurrentTask->id, task->id) ;
+    #endif
+
+    // Sai da fila de prontas e espera na fila de join da tarefa
+    if (wait_block_timeout (&task->join_queue, ticks) == WAIT_TIMEOUT)
+    {
+        preempt_enable () ;
+        return WAIT_TIMEOUT ;
+    }
+
+    *exit_code = task->exit_code ;
+    preempt_enable () ;
+    return (0) ;
+}
+
+int task_join (task_t *task)
+{
+    int exit_code ;
+
+    if (join_ticks (task, -1, &exit_code) < 0)
+        return (-1) ;
+    return exit_code ;
+}
+
+int task_join_timeout (task_t *task, int t, int *exit_code)
+{
+    int code ;
+
+    if (t < 0)
+        return (-1) ;
+    if (exit_code == NULL)
+        exit_code = &code ;
+    return join_ticks (task, ms_ticks (t), exit_code) ;
+}
+
+// Suspende a tarefa corrente até o tick "start + ticks" do relógio interno;
+// esperas maiores do que cabe na roda de tempo são feitas em partes. Os prazos
+// partem de "start", lido uma única vez pelo chamador, então uma demora antes
+// de a tarefa entrar na roda não atrasa o despertar
+void sleep_ticks (unsigned int start, unsigned long long ticks)
+{
+    unsigned int chunk ;
+
+    preempt_disable () ;
+
+    do
+    {
+        chunk = ticks > SLEEP_MAX_TICKS ? SLEEP_MAX_TICKS : (unsigned int) ticks ;
+        ticks -= chunk ;
+
+        // Remove da fila de prontas
+        ready_remove (CurrentTask) ;
+        #if SCHED_MLFQ
+        mlfq_set_level (CurrentTask, CurrentTask->sched_level - 1) ;
+        #endif
+
+        // Calcula o momento que a tarefa deve acordar
+        start += chunk ;
+        CurrentTask->awakening_time = start ;
+
+        // Adiciona na roda de tempo das tarefas adormecidas
+        wheel_start (CurrentTask) ;
+
+        CurrentTask->state = SLEEPING ;
+        task_yield() ;
+    } while (ticks) ;
+
+    preempt_enable () ;
+}
+
+// suspende a tarefa corrente por t milissegundos
+void task_sleep (int t)
+{
+    if (t < 0)
+    {
+        perror("task_sleep: Valor de t inválido") ;
+        return ;
+    }
+
+    if (CurrentTask == NULL)
+    {
+        perror("task_sleep: Valor de CurrentTask inválida") ;
+        return ;
+    }
+
+    #ifdef DEBUG
+        printf("A tarefa %d dormirá por %d\n", CurrentTask->id, t) ;
+    #endif
+
+    #if TICKLESS
+    // acorda no início do milissegundo systime () + t, como no modo periódico
+    unsigned long long now = clock_usec () ;
+
+    sleep_ticks ((unsigned int) now, t ? (unsigned long long) t * 1000 - now % 1000 : 0) ;
+    #else
+    sleep_ticks (clock_ticks (), (unsigned long long) t) ;
+    #endif
+}
+
+// suspende a tarefa corrente por t microssegundos (arredondado para cima para
+// a resolução do relógio: 1 ms no modo periódico, 1 us no modo tickless)
+void task_usleep (int t)
+{
+    if (t < 0)
+    {
+        perror("task_usleep: Valor de t inválido") ;
+        return ;
+    }
+
+    if (CurrentTask == NULL)
+    {
+        perror("task_usleep: Valor de CurrentTask inválida") ;
+        return ;
+    }
+
+    #ifdef DEBUG
+        printf("A tarefa %d dormirá por %d us\n", CurrentTask->id, t) ;
+    #endif
+
+    sleep_ticks (clock_ticks (), ((unsigned long long) t + TICK_USEC - 1) / TICK_USEC) ;
+}
+
+// operações de IPC ============================================================
+
+// semáforos
+
+// cria um semáforo com valor inicial "value"
+int sem_create (semaphore_t *s, int value)
+{
+    if (!s)
+    {
+        perror ("sem_create: semáforo inválido") ;
+        return (-1) ;
+    }
+
+    s->value = value ;
+    s->queue = NULL ;
+    s->policy = WAIT_FIFO ;
+    s->active = 1 ;
+    return (0) ;
+}
+
+// Define a ordem da fila do semáforo (WAIT_FIFO ou WAIT_PRIO); só pode mudar
+// enquanto não há tarefas esperando
+int sem_setpolicy (semaphore_t *s, int policy)
+{
+    if (!s || !s->active || (policy != WAIT_FIFO && policy != WAIT_PRIO) || s->queue)
+        return (-1) ;
+
+    s->policy = policy ;
+    return (0) ;
+}
+
+// requisita o semáforo, esperando no máximo "ticks" ticks (ticks < 0: sem
+// prazo); havendo unidade disponível, não passa pelo escalonador
+int sem_down_ticks (semaphore_t *s, long long ticks)
+{
+    int result ;
+
+    if (!s || !s->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (s->value > 0)
+    {
+        s->value-- ;
+        preempt_enable () ;
+        return (0) ;
+    }
+
+    #ifdef DEBUG
+        printf("A tarefa %d ficou bloqueada no semáforo\n", CurrentTask->id) ;
+    #endif
+
+    // a unidade é entregue diretamente por sem_up (resultado 0), o semáforo
+    // é destruído (-1) ou o prazo vence (WAIT_TIMEOUT)
+    result = wait_block_policy (&s->queue, s->policy, ticks) ;
+
+    preempt_enable () ;
+    return result ;
+}
+
+int sem_down (semaphore_t *s)
+{
+    return sem_down_ticks (s, -1) ;
+}
+
+int sem_down_timeout (semaphore_t *s, int t)
+{
+    if (t < 0)
+        return (-1) ;
+    return sem_down_ticks (s, ms_ticks (t)) ;
+}
+
+// libera o semáforo; se há tarefas esperando, a unidade vai direto para a
+// primeira delas, sem passar pelo contador
+int sem_up (semaphore_t *s)
+{
+    if (!s || !s->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (!wait_wake (&s->queue, 0))
+        s->value++ ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// destroi o semáforo, liberando de uma vez as tarefas bloqueadas (que recebem -1)
+int sem_destroy (semaphore_t *s)
+{
+    if (!s || !s->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    s->active = 0 ;
+    ready_wake_all (&s->queue) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// mutexes
+
+// Inicializa um mutex (sempre inicialmente livre)
+int mutex_create (mutex_t *m)
+{
+    if (!m)
+    {
+        perror ("mutex_create: mutex inválido") ;
+        return (-1) ;
+    }
+
+    m->owner = NULL ;
+    m->queue = NULL ;
+    m->prio = PRIO_MAX ;
+    m->policy = WAIT_FIFO ;
+    m->active = 1 ;
+    return (0) ;
+}
+
+// Define a ordem da fila do mutex (WAIT_FIFO ou WAIT_PRIO); só pode mudar
+// enquanto não há tarefas esperando
+int mutex_setpolicy (mutex_t *m, int policy)
+{
+    if (!m || !m->active || (policy != WAIT_FIFO && policy != WAIT_PRIO) || m->queue)
+        return (-1) ;
+
+    m->policy = policy ;
+    return (0) ;
+}
+
+// Solicita um mutex, esperando no máximo "ticks" ticks (ticks < 0: sem prazo);
+// livre, ele é obtido sem passar pela fila de prontas. Ocupado, o dono herda a
+// prioridade da tarefa que vai esperar por ele (e a mantém mesmo que o prazo
+// dela vença, até liberar seus mutexes).
+int mutex_lock_ticks (mutex_t *m, long long ticks)
+{
+    int result ;
+
+    if (!m || !m->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (!m->owner)
+    {
+        m->owner = CurrentTask ;
+        CurrentTask->mutexes_held++ ;
+        preempt_enable () ;
+        return (0) ;
+    }
+
+    // o mutex não é recursivo
+    if (m->owner == CurrentTask)
+    {
+        preempt_enable () ;
+        return (-1) ;
+    }
+
+    #ifdef DEBUG
+        printf("A tarefa %d espera o mutex da tarefa %d\n", CurrentTask->id, m->owner->id) ;
+    #endif
+
+    if (task_base_prio (CurrentTask) < m->prio)
+        m->prio = task_base_prio (CurrentTask) ;
+    prio_inherit (m->owner, task_base_prio (CurrentTask)) ;
+
+    // mutex_unlock passa o mutex diretamente para esta tarefa (resultado 0)
+    result = wait_block_policy (&m->queue, m->policy, ticks) ;
+
+    preempt_enable () ;
+    return result ;
+}
+
+int mutex_lock (mutex_t *m)
+{
+    return mutex_lock_ticks (m, -1) ;
+}
+
+int mutex_lock_timeout (mutex_t *m, int t)
+{
+    if (t < 0)
+        return (-1) ;
+    return mutex_lock_ticks (m, ms_ticks (t)) ;
+}
+
+// Libera um mutex, entregando-o à primeira tarefa que espera por ele. A tarefa
+// corrente perde a prioridade herdada quando não detém mais nenhum mutex; a nova
+// dona herda a das tarefas que continuam esperando. A fila só é percorrida se o
+// limite m->prio indica que alguma delas pode ser mais prioritária que a nova
+// dona; o percurso recalcula o limite.
+int mutex_unlock (mutex_t *m)
+{
+    task_t *next ;
+
+    if (!m || !m->active || m->owner != CurrentTask)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (!--CurrentTask->mutexes_held && CurrentTask->prio_inherited != PRIO_MAX)
+        prio_restore (CurrentTask) ;
+
+    next = wait_wake (&m->queue, 0) ;
+    m->owner = next ;
+
+    if (next)
+        next->mutexes_held++ ;
+
+    if (!m->queue)
+        m->prio = PRIO_MAX ;
+    else if (m->prio < task_base_prio (next))
+    {
+        task_t *task = m->queue ;
+
+        m->prio = PRIO_MAX ;
+        do
+        {
+            if (task_base_prio (task) < m->prio)
+                m->prio = task_base_prio (task) ;
+            task = task->next ;
+        } while (task != m->queue) ;
+        prio_inherit (next, m->prio) ;
+    }
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// Destrói um mutex, liberando de uma vez as tarefas bloqueadas (que recebem -1);
+// o dono perde a prioridade herdada como em mutex_unlock
+int mutex_destroy (mutex_t *m)
+{
+    if (!m || !m->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    m->active = 0 ;
+    if (m->owner && !--m->owner->mutexes_held && m->owner->prio_inherited != PRIO_MAX)
+        prio_restore (m->owner) ;
+    m->owner = NULL ;
+    ready_wake_all (&m->queue) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// variáveis de condição
+
+// Inicializa uma variável de condição
+int condvar_create (condvar_t *c)
+{
+    if (!c)
+    {
+        perror ("condvar_create: variável de condição inválida") ;
+        return (-1) ;
+    }
+
+    c->queue = NULL ;
+    c->mutex = NULL ;
+    c->timed = 0 ;
+    c->prio = PRIO_MAX ;
+    c->policy = WAIT_FIFO ;
+    c->active = 1 ;
+    return (0) ;
+}
+
+// Define a ordem da fila da condição (WAIT_FIFO ou WAIT_PRIO); só pode mudar
+// enquanto não há tarefas esperando
+int condvar_setpolicy (condvar_t *c, int policy)
+{
+    if (!c || !c->active || (policy != WAIT_FIFO && policy != WAIT_PRIO) || c->queue)
+        return (-1) ;
+
+    c->policy = policy ;
+    return (0) ;
+}
+
+// Passa uma tarefa já retirada da fila da condição para o mutex ("wait
+// morphing"): livre, o mutex é entregue a ela, que fica pronta; ocupado, ela
+// vai para a fila do mutex sem acordar, e só executa quando mutex_unlock o
+// entregar. Uma espera com prazo deixa de ter prazo, pois a condição ocorreu.
+void condvar_morph (condvar_t *c, task_t *task)
+{
+    mutex_t *m = c->mutex ;
+
+    if (task->wait_queue)
+    {
+        wheel_remove (task) ;
+        task->wait_queue = NULL ;
+    }
+
+    if (!m->active)
+        wait_ready (task, -1) ;
+    else if (!m->owner)
+    {
+        m->owner = task ;
+        task->mutexes_held++ ;
+        wait_ready (task, 0) ;
+    }
+    else
+    {
+        wait_insert (&m->queue, m->policy, task) ;
+        if (task_base_prio (task) < m->prio)
+            m->prio = task_base_prio (task) ;
+        prio_inherit (m->owner, task_base_prio (task)) ;
+    }
+}
+
+// Libera o mutex m e espera a condição por no máximo "ticks" ticks (ticks < 0:
+// sem prazo), atomicamente. Sinalizada, a tarefa só volta a executar quando
+// recebe o mutex; se o prazo vence ou a condição é destruída, ela obtém o
+// mutex novamente antes de retornar (WAIT_TIMEOUT ou -1).
+int condvar_wait_ticks (condvar_t *c, mutex_t *m, long long ticks)
+{
+    int result ;
+
+    if (!c || !c->active || !m || !m->active || m->owner != CurrentTask)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    // todas as tarefas na fila da condição usam o mesmo mutex
+    if (!c->queue)
+    {
+        c->mutex = m ;
+        c->prio = PRIO_MAX ;
+        c->timed = 0 ;
+    }
+    else if (c->mutex != m)
+    {
+        preempt_enable () ;
+        return (-1) ;
+    }
+
+    if (task_base_prio (CurrentTask) < c->prio)
+        c->prio = task_base_prio (CurrentTask) ;
+    if (ticks >= 0)
+        c->timed = 1 ;
+
+    mutex_unlock (m) ;
+
+    #ifdef DEBUG
+        printf("A tarefa %d espera a condição\n", CurrentTask->id) ;
+    #endif
+
+    result = wait_block_policy (&c->queue, c->policy, ticks) ;
+
+    // sinalizada, a tarefa recebeu o mutex por condvar_morph ou mutex_unlock
+    if (m->owner != CurrentTask && (mutex_lock (m) < 0 || !result))
+        result = -1 ;
+
+    preempt_enable () ;
+    return result ;
+}
+
+int condvar_wait (condvar_t *c, mutex_t *m)
+{
+    return condvar_wait_ticks (c, m, -1) ;
+}
+
+int condvar_wait_timeout (condvar_t *c, mutex_t *m, int t)
+{
+    if (t < 0)
+        return (-1) ;
+    return condvar_wait_ticks (c, m, ms_ticks (t)) ;
+}
+
+// Sinaliza a condição: a primeira tarefa da fila passa para o mutex
+int condvar_signal (condvar_t *c)
+{
+    task_t *task ;
+
+    if (!c || !c->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    task = taskq_pop_front (&c->queue) ;
+    if (task)
+        condvar_morph (c, task) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// Sinaliza a condição para todas as tarefas da fila. A primeira passa para o
+// mutex como em condvar_signal; as demais são emendadas de uma vez no final da
+// fila do mutex, e o dono herda a melhor prioridade entre elas. Apenas as
+// esperas com prazo precisam ser percorridas, para sair da roda de tempo (e,
+// num mutex WAIT_PRIO, as tarefas são inseridas uma a uma na ordem dele).
+int condvar_broadcast (condvar_t *c)
+{
+    task_t *task ;
+    mutex_t *m ;
+
+    if (!c || !c->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    task = taskq_pop_front (&c->queue) ;
+    if (task)
+        condvar_morph (c, task) ;
+
+    m = c->mutex ;
+    if (c->queue && !m->active)
+        ready_wake_all (&c->queue) ;
+    else if (c->queue)
+    {
+        if (c->timed)
+        {
+            task = c->queue ;
+            do
+            {
+                if (task->wait_queue)
+                {
+                    wheel_remove (task) ;
+                    task->wait_queue = NULL ;
+                }
+                task = task->next ;
+            } while (task != c->queue) ;
+            c->timed = 0 ;
+        }
+        if (c->prio < m->prio)
+            m->prio = c->prio ;
+        prio_inherit (m->owner, c->prio) ;
+        if (m->policy == WAIT_FIFO)
+            taskq_concat (&m->queue, &c->queue) ;
+        else
+            while ((task = taskq_pop_front (&c->queue)))
+                wait_insert (&m->queue, m->policy, task) ;
+    }
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// Destrói uma variável de condição, liberando de uma vez as tarefas bloqueadas
+// (que obtêm o mutex novamente e recebem -1)
+int condvar_destroy (condvar_t *c)
+{
+    if (!c || !c->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    c->active = 0 ;
+    ready_wake_all (&c->queue) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// travas de leitura e escrita
+
+// Inicializa uma trava de leitura e escrita (inicialmente livre)
+int rwlock_create (rwlock_t *l)
+{
+    if (!l)
+    {
+        perror ("rwlock_create: trava inválida") ;
+        return (-1) ;
+    }
+
+    l->readers = 0 ;
+    l->writer = NULL ;
+    l->phase = 0 ;
+    l->waiting = 0 ;
+    l->read_queue = NULL ;
+    l->write_queue = NULL ;
+    l->policy = WAIT_FIFO ;
+    l->active = 1 ;
+    return (0) ;
+}
+
+// Define a ordem da fila de escritores (WAIT_FIFO ou WAIT_PRIO); só pode mudar
+// enquanto não há tarefas esperando
+int rwlock_setpolicy (rwlock_t *l, int policy)
+{
+    if (!l || !l->active || (policy != WAIT_FIFO && policy != WAIT_PRIO) || l->write_queue)
+        return (-1) ;
+
+    l->policy = policy ;
+    return (0) ;
+}
+
+// Inicia uma fase de leitura: todos os leitores que esperavam passam a contar
+// como leitores e a fila deles é emendada de uma vez na fila de prontas
+void rwlock_read_phase (rwlock_t *l)
+{
+    l->readers += l->waiting ;
+    l->waiting = 0 ;
+    l->phase++ ;
+    ready_wake_all (&l->read_queue) ;
+}
+
+// Solicita a trava para leitura, esperando no máximo "ticks" ticks (ticks < 0:
+// sem prazo). Sem escritor escrevendo ou esperando, a leitura começa sem passar
+// pelo escalonador; senão o leitor espera a próxima fase de leitura, e sabe se
+// ela foi liberada (0) ou se a trava foi destruída (-1) comparando a fase.
+int rwlock_rdlock_ticks (rwlock_t *l, long long ticks)
+{
+    int phase, result ;
+
+    if (!l || !l->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (!l->writer && !l->write_queue)
+    {
+        l->readers++ ;
+        preempt_enable () ;
+        return (0) ;
+    }
+
+    #ifdef DEBUG
+        printf("A tarefa %d espera a fase de leitura\n", CurrentTask->id) ;
+    #endif
+
+    phase = l->phase ;
+    l->waiting++ ;
+    result = wait_block_timeout (&l->read_queue, ticks) ;
+
+    if (l->phase != phase)
+        result = 0 ;
+    else if (result == WAIT_TIMEOUT)
+        l->waiting-- ;
+    else
+        result = -1 ;
+
+    preempt_enable () ;
+    return result ;
+}
+
+int rwlock_rdlock (rwlock_t *l)
+{
+    return rwlock_rdlock_ticks (l, -1) ;
+}
+
+int rwlock_rdlock_timeout (rwlock_t *l, int t)
+{
+    if (t < 0)
+        return (-1) ;
+    return rwlock_rdlock_ticks (l, ms_ticks (t)) ;
+}
+
+// Solicita a trava para escrita, esperando no máximo "ticks" ticks (ticks < 0:
+// sem prazo); rwlock_unlock entrega a trava diretamente ao escritor (0). Se o
+// prazo vence e não resta escritor, os leitores que esperavam por causa dele
+// são liberados.
+int rwlock_wrlock_ticks (rwlock_t *l, long long ticks)
+{
+    int result ;
+
+    if (!l || !l->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (!l->writer && !l->readers)
+    {
+        l->writer = CurrentTask ;
+        preempt_enable () ;
+        return (0) ;
+    }
+
+    // a trava não é recursiva
+    if (l->writer == CurrentTask)
+    {
+        preempt_enable () ;
+        return (-1) ;
+    }
+
+    #ifdef DEBUG
+        printf("A tarefa %d espera a trava para escrita\n", CurrentTask->id) ;
+    #endif
+
+    result = wait_block_policy (&l->write_queue, l->policy, ticks) ;
+
+    if (result == WAIT_TIMEOUT && !l->writer && !l->write_queue && l->waiting)
+        rwlock_read_phase (l) ;
+
+    preempt_enable () ;
+    return result ;
+}
+
+int rwlock_wrlock (rwlock_t *l)
+{
+    return rwlock_wrlock_ticks (l, -1) ;
+}
+
+int rwlock_wrlock_timeout (rwlock_t *l, int t)
+{
+    if (t < 0)
+        return (-1) ;
+    return rwlock_wrlock_ticks (l, ms_ticks (t)) ;
+}
+
+// Libera a trava. O escritor que termina libera primeiro os leitores que
+// esperam (uma fase de leitura), e só na falta deles o próximo escritor; o
+// último leitor de uma fase entrega a trava ao primeiro escritor. Assim as fases
+// se alternam e nenhum dos lados espera mais do que uma fase do outro.
+int rwlock_unlock (rwlock_t *l)
+{
+    if (!l || !l->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (l->writer == CurrentTask)
+    {
+        l->writer = NULL ;
+        if (l->waiting)
+            rwlock_read_phase (l) ;
+        else
+            l->writer = wait_wake (&l->write_queue, 0) ;
+    }
+    else if (l->readers > 0)
+    {
+        if (!--l->readers)
+            l->writer = wait_wake (&l->write_queue, 0) ;
+    }
+    else
+    {
+        preempt_enable () ;
+        return (-1) ;
+    }
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// Destrói uma trava, liberando de uma vez as tarefas bloqueadas (que recebem -1)
+int rwlock_destroy (rwlock_t *l)
+{
+    if (!l || !l->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    l->active = 0 ;
+    ready_wake_all (&l->read_queue) ;
+    ready_wake_all (&l->write_queue) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// barreiras
+
+// Inicializa uma barreira para N tarefas
+int barrier_create (barrier_t *b, int N)
+{
+    if (!b || N < 1)
+    {
+        perror ("barrier_create: barreira inválida") ;
+        return (-1) ;
+    }
+
+    b->size = N ;
+    b->count = 0 ;
+    b->phase = 0 ;
+    b->queue = NULL ;
+    b->active = 1 ;
+    return (0) ;
+}
+
+// Chega a uma barreira. A N-ésima tarefa avança a fase da barreira e emenda de
+// uma vez a fila de espera na fila de prontas; a barreira fica pronta para a
+// fase seguinte sem ser reinicializada. Quem esperava sabe se foi liberado (0)
+// ou se a barreira foi destruída (-1) comparando a fase; um contador, e não um
+// bit de sentido, porque com mais de N tarefas a barreira pode ser liberada de
+// novo antes de a tarefa voltar a executar. Se o
+// prazo de "ticks" ticks vence antes (ticks < 0: sem prazo), a tarefa deixa de
+// contar como chegada na fase.
+int barrier_join_ticks (barrier_t *b, long long ticks)
+{
+    int phase, result ;
+
+    if (!b || !b->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    phase = b->phase ;
+    if (++b->count == b->size)
+    {
+        b->count = 0 ;
+        b->phase++ ;
+        ready_wake_all (&b->queue) ;
+        preempt_enable () ;
+        return (0) ;
+    }
+
+    result = wait_block_timeout (&b->queue, ticks) ;
+
+    if (b->phase != phase)
+        result = 0 ;
+    else if (result == WAIT_TIMEOUT)
+        b->count-- ;
+    else
+        result = -1 ;
+
+    preempt_enable () ;
+    return result ;
+}
+
+int barrier_join (barrier_t *b)
+{
+    return barrier_join_ticks (b, -1) ;
+}
+
+int barrier_join_timeout (barrier_t *b, int t)
+{
+    if (t < 0)
+        return (-1) ;
+    return barrier_join_ticks (b, ms_ticks (t)) ;
+}
+
+// Destrói uma barreira, liberando de uma vez as tarefas bloqueadas (que recebem -1)
+int barrier_destroy (barrier_t *b)
+{
+    if (!b || !b->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    b->active = 0 ;
+    ready_wake_all (&b->queue) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// filas de mensagens
+
+// Endereço da posição de índice i da fila
+static inline char *mqueue_slot (mqueue_t *queue, unsigned int i)
+{
+    return queue->buffer + (size_t) (i & queue->mask) * queue->size ;
+}
+
+// Índice da posição de uma mensagem devolvida por mqueue_reserve/mqueue_peek
+// dentro do trecho [from, to) da fila; -1 se ela não está nesse trecho
+static inline int mqueue_index (mqueue_t *queue, void *msg, unsigned int from, unsigned int to, unsigned int *i)
+{
+    ptrdiff_t offset = (char *) msg - queue->buffer ;
+    unsigned int slot ;
+
+    if (offset < 0 || offset % queue->size || offset / queue->size > queue->mask)
+        return (-1) ;
+
+    // a posição pertence ao trecho se algum índice dele cai nela
+    slot = (unsigned int) (offset / queue->size) ;
+    *i = from + ((slot - from) & queue->mask) ;
+    if (*i - from >= to - from)
+        return (-1) ;
+    return (0) ;
+}
+
+// Espera haver espaço (writer = 1) ou mensagem (writer = 0) na fila, por no
+// máximo "ticks" ticks (ticks < 0: sem prazo). Deve ser chamada com a preempção
+// desativada; retorna -1 se a fila foi destruída ou WAIT_TIMEOUT.
+int mqueue_wait (mqueue_t *queue, int writer, long long ticks)
+{
+    int result ;
+
+    while (queue->active)
+    {
+        if (writer && queue->reserve - queue->head < (unsigned int) queue->max)
+            return (0) ;
+        if (!writer && queue->tail != queue->peek)
+            return (0) ;
+
+        result = wait_block_policy (writer ? &queue->senders : &queue->receivers, queue->policy, ticks) ;
+        if (result < 0)
+            return result ;
+
+        // quem foi acordado e perdeu a vez espera só o que resta do prazo
+        if (ticks >= 0)
+            ticks = wait_ticks_left () ;
+    }
+    return (-1) ;
+}
+
+// Marca a posição i como publicada e avança tail sobre as posições publicadas
+// em sequência, acordando um receptor por mensagem disponível
+void mqueue_publish (mqueue_t *queue, unsigned int i)
+{
+    queue->done[i & queue->mask] = 1 ;
+    while (queue->tail != queue->reserve && queue->done[queue->tail & queue->mask])
+    {
+        queue->done[queue->tail++ & queue->mask] = 0 ;
+        wait_wake (&queue->receivers, 0) ;
+    }
+}
+
+// Marca a posição i como liberada e avança head sobre as posições liberadas em
+// sequência, acordando um emissor por posição livre
+void mqueue_free (mqueue_t *queue, unsigned int i)
+{
+    queue->done[i & queue->mask] = 1 ;
+    while (queue->head != queue->peek && queue->done[queue->head & queue->mask])
+    {
+        queue->done[queue->head++ & queue->mask] = 0 ;
+        wait_wake (&queue->senders, 0) ;
+    }
+}
+
+// cria uma fila para até max mensagens de size bytes cada
+int mqueue_create (mqueue_t *queue, int max, int size)
+{
+    unsigned int slots = 1 ;
+
+    if (!queue || max < 1 || size < 1)
+    {
+        perror ("mqueue_create: parâmetros inválidos") ;
+        return (-1) ;
+    }
+
+    while (slots < (unsigned int) max)
+        slots <<= 1 ;
+
+    queue->buffer = malloc ((size_t) slots * size) ;
+    queue->done = calloc (slots, 1) ;
+    if (!queue->buffer || !queue->done)
+    {
+        perror ("mqueue_create: erro na alocação da fila") ;
+        free (queue->buffer) ;
+        free (queue->done) ;
+        return (-1) ;
+    }
+
+    queue->size = size ;
+    queue->max = max ;
+    queue->mask = slots - 1 ;
+    queue->head = queue->peek = queue->tail = queue->reserve = 0 ;
+    queue->senders = NULL ;
+    queue->receivers = NULL ;
+    queue->policy = WAIT_FIFO ;
+    queue->active = 1 ;
+    return (0) ;
+}
+
+// Define a ordem das filas de emissores e receptores (WAIT_FIFO ou WAIT_PRIO);
+// só pode mudar enquanto não há tarefas esperando
+int mqueue_setpolicy (mqueue_t *queue, int policy)
+{
+    if (!queue || !queue->active || (policy != WAIT_FIFO && policy != WAIT_PRIO) || queue->senders || queue->receivers)
+        return (-1) ;
+
+    queue->policy = policy ;
+    return (0) ;
+}
+
+void *mqueue_reserve (mqueue_t *queue)
+{
+    char *msg ;
+
+    if (!queue || !queue->active)
+        return NULL ;
+
+    preempt_disable () ;
+
+    if (mqueue_wait (queue, 1, -1) < 0)
+    {
+        preempt_enable () ;
+        return NULL ;
+    }
+    msg = mqueue_slot (queue, queue->reserve++) ;
+
+    preempt_enable () ;
+    return msg ;
+}
+
+int mqueue_commit (mqueue_t *queue, void *msg)
+{
+    unsigned int i ;
+
+    if (!queue || !queue->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (mqueue_index (queue, msg, queue->tail, queue->reserve, &i) < 0)
+    {
+        preempt_enable () ;
+        return (-1) ;
+    }
+    mqueue_publish (queue, i) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+void *mqueue_peek (mqueue_t *queue)
+{
+    char *msg ;
+
+    if (!queue || !queue->active)
+        return NULL ;
+
+    preempt_disable () ;
+
+    if (mqueue_wait (queue, 0, -1) < 0)
+    {
+        preempt_enable () ;
+        return NULL ;
+    }
+    msg = mqueue_slot (queue, queue->peek++) ;
+
+    preempt_enable () ;
+    return msg ;
+}
+
+int mqueue_release (mqueue_t *queue, void *msg)
+{
+    unsigned int i ;
+
+    if (!queue || !queue->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (mqueue_index (queue, msg, queue->head, queue->peek, &i) < 0)
+    {
+        preempt_enable () ;
+        return (-1) ;
+    }
+    mqueue_free (queue, i) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// envia até n mensagens, esperando espaço por no máximo "ticks" ticks
+// (ticks < 0: sem prazo); retorna quantas foram enviadas, -1 ou WAIT_TIMEOUT
+int mqueue_send_ticks (mqueue_t *queue, void *msgs, int n, long long ticks)
+{
+    unsigned int i ;
+    int sent, result ;
+
+    if (!queue || !queue->active || !msgs || n < 1)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if ((result = mqueue_wait (queue, 1, ticks)) < 0)
+    {
+        preempt_enable () ;
+        return result ;
+    }
+
+    // copia todas as mensagens que cabem e só depois as publica
+    for (sent = 0; sent < n && queue->reserve - queue->head < (unsigned int) queue->max; sent++)
+        memcpy (mqueue_slot (queue, queue->reserve++), (char *) msgs + (size_t) sent * queue->size, queue->size) ;
+    for (i = queue->reserve - sent; i != queue->reserve; i++)
+        mqueue_publish (queue, i) ;
+
+    preempt_enable () ;
+    return sent ;
+}
+
+// recebe até n mensagens, esperando alguma por no máximo "ticks" ticks
+// (ticks < 0: sem prazo); retorna quantas foram recebidas, -1 ou WAIT_TIMEOUT
+int mqueue_recv_ticks (mqueue_t *queue, void *msgs, int n, long long ticks)
+{
+    unsigned int i ;
+    int received, result ;
+
+    if (!queue || !queue->active || !msgs || n < 1)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if ((result = mqueue_wait (queue, 0, ticks)) < 0)
+    {
+        preempt_enable () ;
+        return result ;
+    }
+
+    for (received = 0; received < n && queue->peek != queue->tail; received++)
+        memcpy ((char *) msgs + (size_t) received * queue->size, mqueue_slot (queue, queue->peek++), queue->size) ;
+    for (i = queue->peek - received; i != queue->peek; i++)
+        mqueue_free (queue, i) ;
+
+    preempt_enable () ;
+    return received ;
+}
+
+// envia uma mensagem para a fila: uma cópia, direto para a posição reservada
+int mqueue_send (mqueue_t *queue, void *msg)
+{
+    return (mqueue_send_ticks (queue, msg, 1, -1) < 0) ? (-1) : 0 ;
+}
+
+// recebe uma mensagem da fila: uma cópia, direto da posição da mensagem
+int mqueue_recv (mqueue_t *queue, void *msg)
+{
+    return (mqueue_recv_ticks (queue, msg, 1, -1) < 0) ? (-1) : 0 ;
+}
+
+int mqueue_send_batch (mqueue_t *queue, void *msgs, int n)
+{
+    return mqueue_send_ticks (queue, msgs, n, -1) ;
+}
+
+int mqueue_recv_batch (mqueue_t *queue, void *msgs, int n)
+{
+    return mqueue_recv_ticks (queue, msgs, n, -1) ;
+}
+
+int mqueue_send_timeout (mqueue_t *queue, void *msg, int t)
+{
+    int result ;
+
+    if (t < 0)
+        return (-1) ;
+    result = mqueue_send_ticks (queue, msg, 1, ms_ticks (t)) ;
+    return (result < 0) ? result : 0 ;
+}
+
+int mqueue_recv_timeout (mqueue_t *queue, void *msg, int t)
+{
+    int result ;
+
+    if (t < 0)
+        return (-1) ;
+    result = mqueue_recv_ticks (queue, msg, 1, ms_ticks (t)) ;
+    return (result < 0) ? result : 0 ;
+}
+
+// destroi a fila, liberando de uma vez as tarefas bloqueadas (que recebem -1);
+// ponteiros obtidos com mqueue_reserve/mqueue_peek deixam de valer
+int mqueue_destroy (mqueue_t *queue)
+{
+    if (!queue || !queue->active)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    queue->active = 0 ;
+    free (queue->buffer) ;
+    free (queue->done) ;
+    queue->buffer = queue->done = NULL ;
+    ready_wake_all (&queue->senders) ;
+    ready_wake_all (&queue->receivers) ;
+
+    preempt_enable () ;
+    return (0) ;
+}
+
+// informa o número de mensagens atualmente na fila (disponíveis para leitura)
+int mqueue_msgs (mqueue_t *queue)
+{
+    if (!queue || !queue->active)
+        return (-1) ;
+
+    return (int) (queue->tail - queue->peek) ;
+}
+
+// esperas por endereço
+
+// Fila da tabela de esperas do endereço addr (hash multiplicativo de Fibonacci:
+// os bits altos do produto dependem de todos os bits do endereço)
+static inline task_t **wait_bucket (int *addr)
+{
+    uint32_t key = (uint32_t) ((uintptr_t) addr / sizeof (int)) ;
+
+    return &WaitBuckets[(key * 2654435761u) >> (32 - WAIT_BITS)] ;
+}
+
+// Bloqueia a tarefa corrente na fila de addr, por no máximo "ticks" ticks
+// (ticks < 0: sem prazo), se *addr ainda vale expected; senão retorna
+// WAIT_CHANGED sem bloquear. A comparação e o bloqueio são feitos com a
+// preempção desativada, então um ppos_wake feito depois de alterar *addr não se
+// perde. Um objeto construído sobre ppos_wait não guarda estado no núcleo e não
+// custa nada enquanto não há espera.
+int ppos_wait_ticks (int *addr, int expected, long long ticks)
+{
+    int result = WAIT_CHANGED ;
+
+    if (!addr)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    if (*addr == expected)
+    {
+        #ifdef DEBUG
+            printf("A tarefa %d espera o endereço %p\n", CurrentTask->id, (void *) addr) ;
+        #endif
+
+        CurrentTask->wait_addr = addr ;
+        result = wait_block_timeout (wait_bucket (addr), ticks) ;
+    }
+
+    preempt_enable () ;
+    return result ;
+}
+
+int ppos_wait (int *addr, int expected)
+{
+    return ppos_wait_ticks (addr, expected, -1) ;
+}
+
+int ppos_wait_timeout (int *addr, int expected, int t)
+{
+    if (t < 0)
+        return (-1) ;
+    return ppos_wait_ticks (addr, expected, ms_ticks (t)) ;
+}
+
+// Acorda até n tarefas (n < 0: todas) que esperam em addr, na ordem em que
+// chegaram. Percorre só a fila de addr na tabela, que pode conter tarefas
+// esperando outros endereços com o mesmo hash.
+int ppos_wake (int *addr, int n)
+{
+    task_t **bucket, *task, *next, *last ;
+    int woken = 0, done ;
+
+    if (!addr)
+        return (-1) ;
+
+    preempt_disable () ;
+
+    bucket = wait_bucket (addr) ;
+    if (*bucket && n)
+    {
+        task = *bucket ;
+        last = task->prev ;
+        do
+        {
+            next = task->next ;
+            done = (task == last) ;
+            if (task->wait_addr == addr)
+            {
+                taskq_remove (bucket, task) ;
+                wait_ready (task, 0) ;
+                woken++ ;
+            }
+            task = next ;
+        } while (!done && woken != n) ;
+    }
+
+    preempt_enable () ;
+    return woken ;
+}
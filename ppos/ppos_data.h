@@ -6,51 +6,221 @@
 #ifndef __PPOS_DATA__
 #define __PPOS_DATA__
 
-#include <ucontext.h>		// biblioteca POSIX de trocas de contexto
+#include <signal.h>		// sigset_t
+#include <stddef.h>		// size_t
 #include "queue.h"		// biblioteca de filas genéricas
+#include "deque_inline.h"	// deque em vetor circular
+
+// Em x86-64 e AArch64 a troca de contexto é feita por uma rotina própria, que
+// salva só os registradores preservados entre chamadas e o ponteiro de pilha;
+// nas demais arquiteturas (ou com -DUSE_UCONTEXT) usa swapcontext
+#if (defined(__x86_64__) || defined(__aarch64__)) && !defined(USE_UCONTEXT)
+#define NATIVE_SWITCH
+#else
+#include <ucontext.h>		// biblioteca POSIX de trocas de contexto
+#endif
 
 enum states_e {READY, EXITED, SUSPENDED, SLEEPING} ;
 
-// Estrutura que define um Task Control Block (TCB)
+#define PRIO_MIN -20                              // prioridade mais alta
+#define PRIO_MAX 20                               // prioridade mais baixa
+#define PRIO_LEVELS (PRIO_MAX - PRIO_MIN + 1)     // quantidade de níveis de prioridade
+
+// ordem das filas de espera de um objeto de sincronização: chegada, ou
+// prioridade dinâmica (e chegada entre prioridades iguais)
+enum wait_policy_e {WAIT_FIFO, WAIT_PRIO} ;
+
+// Estrutura que define um Task Control Block (TCB). Os campos usados pelo
+// escalonador e pela troca de contexto ficam juntos nos primeiros 64 bytes (o
+// tamanho de uma linha de cache); os campos usados só na criação e no fim da
+// tarefa, e o ucontext_t (perto de 1 KB), ficam depois deles.
 typedef struct task_t
 {
+   // campos quentes: filas, escalonamento, roda de tempo e troca de contexto
    struct task_t *prev, *next ;		// ponteiros para usar em filas
    int id ;				                // identificador da tarefa
-   ucontext_t context ;			      // contexto armazenado da tarefa
    enum states_e state ;          // salva o estado da tarefa
    int prio_static ;              // Prioridade estática
-   int prio_dinamic ;             // prioridade dinâmica
+   int prio_dinamic ;             // prioridade dinâmica (valor na época prio_epoch)
+   unsigned int prio_epoch ;      // época de envelhecimento em que prio_dinamic foi definida
+   unsigned int awakening_time ;  // O tick do relógio interno em que a tarefa adormecida devera acordar
+   union {
+      int wheel_slot ;            // posição da tarefa adormecida na roda de tempo
+      unsigned int ready_pos ;    // posição da tarefa pronta no deque do balde (READY_DEQUE)
+   } ;
+   unsigned int activations ;     // quantidade de vezes que a tarefa foi acionada
+#ifdef NATIVE_SWITCH
+   void *context ;                // ponteiro de pilha salvo; os registradores ficam na própria pilha
+#endif
+   struct stack_group_t *stack_group ; // grupo de pilha compartilhada da tarefa, ou NULL
+
+   // campos da espera com prazo: a tarefa fica na roda de tempo pelos ponteiros
+   // timer_* e, ao mesmo tempo, na fila de espera *wait_queue por prev/next
+   struct task_t *timer_prev, *timer_next ; // ponteiros para usar na roda de tempo
+   struct task_t **wait_queue ;   // fila de espera com prazo em que a tarefa está, ou NULL
+   unsigned long long wait_extra ; // ticks de espera além do prazo na roda (esperas maiores que o alcance dela)
+
+   // campos frios: criação, encerramento e pilha
+   void (*start_func)(void *) ;   // corpo da tarefa
+   void *start_arg ;              // argumento do corpo da tarefa
    unsigned int start_time ;      // momento de inicio da tarefa
    unsigned int exit_time ;       // momento de fim da tarefa
    unsigned int processor_time ;  // acumulado do tempo de processador da tarefa
-   unsigned int awakening_time ;  // O tempo que a tarefa adormecida devera acordar 
-   unsigned int activations ;     // quantidade de vezes que a tarefa foi acionada
-   struct task_t *join_queue ;    // Fila que guarda todas as tarefas que estão esperando essa tarefa terminar
    int exit_code ;                // Código de encerramento que a tarefa recebeu
+   struct task_t *join_queue ;    // Fila que guarda todas as tarefas que estão esperando essa tarefa terminar
+   int wait_result ;              // resultado da última espera bloqueante (0: atendida, -1: objeto destruído)
+   int prio_inherited ;           // prioridade herdada de quem espera um mutex desta tarefa (PRIO_MAX: nenhuma)
+   int mutexes_held ;             // mutexes que a tarefa detém
+   int *wait_addr ;               // endereço esperado em ppos_wait
+   int sched_level ;              // nível da tarefa no escalonamento MLFQ (0: mais interativo)
+   void *stack ;                  // pilha da tarefa (NULL se ela usa uma pilha compartilhada)
+   size_t stack_size ;            // tamanho da pilha da tarefa
+   int stack_mapped ;             // a pilha veio de stack_alloc (mmap com guarda), senão de malloc
+   void *stack_save ;             // cópia da parte usada da pilha compartilhada
+   size_t stack_saved ;           // bytes guardados em stack_save
+   size_t stack_save_size ;       // capacidade de stack_save
+#ifdef SWITCH_SIGMASK
+   sigset_t sigmask ;             // máscara de sinais da tarefa, trocada junto com o contexto
+#endif
+#ifndef NATIVE_SWITCH
+   ucontext_t context ;			      // contexto armazenado da tarefa
+#endif
 } task_t ;
 
+// Grupo de tarefas que executam sobre uma mesma pilha: só a tarefa dona ocupa a
+// pilha; as demais guardam apenas a parte usada da pilha delas, que é copiada de
+// volta quando voltam a executar. Uma tarefa do grupo não pode passar para
+// outras tarefas ponteiros para variáveis da sua pilha.
+typedef struct stack_group_t
+{
+   void *stack ;                  // pilha compartilhada
+   size_t size ;                  // tamanho da pilha compartilhada
+   struct task_t *owner ;         // tarefa cujo conteúdo está na pilha, ou NULL
+   int tasks ;                    // tarefas vivas do grupo
+} stack_group_t ;
+
+// Atributos de criação de uma tarefa (task_create_attr); campos em 0 usam o padrão
+typedef struct
+{
+   size_t stack_size ;            // tamanho da pilha, arredondado para uma potência de 2
+   stack_group_t *stack_group ;   // executa na pilha compartilhada deste grupo (stack_size é ignorado)
+} task_attr_t ;
+
+// 1: cada balde da fila de prontas é um deque em vetor circular (deque_inline.h)
+// em vez de uma fila circular encadeada; percorrer e girar um balde com dezenas
+// de milhares de tarefas não segue um ponteiro por tarefa
+#ifndef READY_DEQUE
+#define READY_DEQUE 0
+#endif
+
+DEQUE_TYPE (taskdq, struct task_t)
+
+// Fila de prontas: um balde (fila circular) por nível de prioridade dinâmica.
+// Os baldes são indexados de forma circular pela época de envelhecimento, assim
+// envelhecer todas as tarefas é só avançar a época e localizar a tarefa de maior
+// prioridade é um "find first set" no bitmap de baldes ocupados.
+typedef struct
+{
+#if READY_DEQUE
+   taskdq_t bucket[PRIO_LEVELS] ; // baldes de tarefas prontas
+#else
+   task_t *bucket[PRIO_LEVELS] ;  // baldes de tarefas prontas
+#endif
+   unsigned long long bitmap ;    // bit i ligado se bucket[i] não está vazio
+   unsigned int epoch ;           // época atual de envelhecimento
+   int base ;                     // balde que representa PRIO_MIN (epoch % PRIO_LEVELS)
+   int count ;                    // quantidade de tarefas na fila
+   task_t *wake ;                 // tarefas acordadas em bloco, ainda fora dos baldes
+} ready_queue_t ;
+
+#define WHEEL_LEVELS 4                            // níveis da roda de tempo
+#define WHEEL_BITS 8                              // bits do relógio por nível
+#define WHEEL_SLOTS (1 << WHEEL_BITS)             // posições em cada nível
+
+// Roda de tempo hierárquica das tarefas adormecidas: o nível 0 tem uma posição
+// por tick e cada nível acima cobre WHEEL_SLOTS vezes mais tempo por posição.
+// Ao completar uma volta de um nível, a posição corrente do nível de cima é
+// redistribuída ("cascata") nos níveis de baixo.
+typedef struct
+{
+   task_t *slot[WHEEL_LEVELS][WHEEL_SLOTS] ;                  // filas de tarefas por posição
+   unsigned long long bitmap[WHEEL_LEVELS][WHEEL_SLOTS / 64] ; // posições não vazias
+   unsigned int time ;            // tick corrente (os anteriores já foram processados)
+   int count ;                    // quantidade de tarefas na roda
+} timer_wheel_t ;
+
 // estrutura que define um semáforo
 typedef struct
 {
-  // preencher quando necessário
+   int value ;                    // unidades disponíveis
+   task_t *queue ;                // tarefas bloqueadas, em ordem de chegada
+   int policy ;                   // ordem da fila (WAIT_FIFO ou WAIT_PRIO)
+   int active ;                   // 1 entre sem_create e sem_destroy
 } semaphore_t ;
 
 // estrutura que define um mutex
 typedef struct
 {
-  // preencher quando necessário
+   task_t *owner ;                // tarefa que detém o mutex, ou NULL se livre
+   task_t *queue ;                // tarefas bloqueadas, em ordem de chegada
+   int prio ;                     // limite para a melhor prioridade entre as tarefas da fila
+   int policy ;                   // ordem da fila (WAIT_FIFO ou WAIT_PRIO)
+   int active ;                   // 1 entre mutex_create e mutex_destroy
 } mutex_t ;
 
+// estrutura que define uma variável de condição
+typedef struct
+{
+   task_t *queue ;                // tarefas esperando a condição, em ordem de chegada
+   mutex_t *mutex ;               // mutex usado pelas tarefas da fila
+   int timed ;                    // 1 se alguma tarefa da fila espera com prazo
+   int prio ;                     // melhor prioridade entre as tarefas da fila
+   int policy ;                   // ordem da fila (WAIT_FIFO ou WAIT_PRIO)
+   int active ;                   // 1 entre condvar_create e condvar_destroy
+} condvar_t ;
+
+// estrutura que define uma trava de leitura e escrita com fases alternadas:
+// leitores que chegam enquanto há escritor esperando ficam para a próxima fase
+// de leitura, e cada escritor que termina libera primeiro os leitores
+typedef struct
+{
+   int readers ;                  // tarefas lendo na fase atual
+   task_t *writer ;               // tarefa escrevendo, ou NULL
+   int phase ;                    // incrementada a cada fase de leitura liberada
+   int waiting ;                  // tarefas em read_queue
+   task_t *read_queue ;           // leitores esperando a próxima fase
+   task_t *write_queue ;          // escritores esperando, em ordem de chegada
+   int policy ;                   // ordem da fila de escritores (WAIT_FIFO ou WAIT_PRIO)
+   int active ;                   // 1 entre rwlock_create e rwlock_destroy
+} rwlock_t ;
+
 // estrutura que define uma barreira
 typedef struct
 {
-  // preencher quando necessário
+   int size ;                     // tarefas que precisam chegar para liberar a barreira
+   int count ;                    // tarefas que já chegaram na fase atual
+   int phase ;                    // incrementada a cada liberação da barreira
+   task_t *queue ;                // tarefas esperando a fase atual terminar
+   int active ;                   // 1 entre barrier_create e barrier_destroy
 } barrier_t ;
 
-// estrutura que define uma fila de mensagens
+// estrutura que define uma fila de mensagens: um vetor circular de posições de
+// "size" bytes, alocado uma só vez. Os índices crescem sem parar e a posição i
+// fica em buffer[(i & mask) * size]. As mensagens passam por quatro fronteiras:
+// head <= peek <= tail <= reserve. [head, peek) estão sendo lidas no lugar,
+// [peek, tail) estão disponíveis e [tail, reserve) estão sendo escritas.
 typedef struct
 {
-  // preencher quando necessário
+   char *buffer ;                 // posições das mensagens
+   char *done ;                   // posição já publicada (escrita) ou liberada (leitura) fora de ordem
+   int size ;                     // tamanho de cada mensagem
+   int max ;                      // capacidade da fila, em mensagens
+   unsigned int mask ;            // quantidade de posições - 1 (potência de 2 >= max)
+   unsigned int head, peek, tail, reserve ;
+   task_t *senders ;              // tarefas esperando espaço
+   task_t *receivers ;            // tarefas esperando mensagens
+   int policy ;                   // ordem das filas de espera (WAIT_FIFO ou WAIT_PRIO)
+   int active ;                   // 1 entre mqueue_create e mqueue_destroy
 } mqueue_t ;
 
 #endif
@@ -7,6 +7,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include "queue.h"
+#include "queue_ext.h"
+
+// Com NDEBUG (compilação de produção), queue_append e queue_remove executam em
+// tempo constante: não percorrem a fila para verificar se o elemento já está
+// nela (-8) ou se pertence a ela (-6, -7). As demais verificações continuam.
+#ifndef QUEUE_CHECKED
+#ifdef NDEBUG
+#define QUEUE_CHECKED 0
+#else
+#define QUEUE_CHECKED 1
+#endif
+#endif
 
 int queue_size (queue_t *queue)
 {
@@ -93,6 +105,7 @@ int queue_append (queue_t **queue, queue_t *elem)
         return 0;
     }
 
+#if QUEUE_CHECKED
     // Verifica se o elemento já está na fila
     queue_t *aux = (*queue);
     do {
@@ -102,6 +115,7 @@ int queue_append (queue_t **queue, queue_t *elem)
         }
         aux = aux->next;
     } while (aux != (*queue));
+#endif
 
     queue_t *last = (*queue)->prev;
     last->next = elem;
@@ -157,6 +171,16 @@ int queue_remove (queue_t **queue, queue_t *elem)
         return 0;
     }
 
+#if !QUEUE_CHECKED
+    // O elemento está em uma fila e confia-se que seja esta
+    elem->next->prev = elem->prev;
+    elem->prev->next = elem->next;
+
+    elem->next = NULL;
+    elem->prev = NULL;
+
+    return 0;
+#else
     queue_t *aux = (*queue)->next;
     while (aux != (*queue))
     {
@@ -180,5 +204,101 @@ int queue_remove (queue_t **queue, queue_t *elem)
 
     fprintf(stderr, "ERRO: Elemento a ser removido não está na fila!\n");
     return -6;
+#endif
+}
+
+
+int queue_concat (queue_t **dst, queue_t **src)
+{
+    if ((dst == NULL) || (src == NULL)) {
+        fprintf(stderr, "ERRO queue_concat: A fila não existe.\n");
+        return -1;
+    }
+
+    // Nada a emendar (emendar a fila nela mesma também não muda nada)
+    if (((*src) == NULL) || (dst == src)) {
+        return 0;
+    }
+
+    if ((*dst) == NULL) {
+        (*dst) = (*src);
+        (*src) = NULL;
+
+        return 0;
+    }
+
+    // Liga o último de dst ao primeiro de src e o último de src ao primeiro de dst
+    queue_t *dst_last = (*dst)->prev;
+    queue_t *src_last = (*src)->prev;
+
+    dst_last->next = (*src);
+    (*src)->prev = dst_last;
+    src_last->next = (*dst);
+    (*dst)->prev = src_last;
+
+    (*src) = NULL;
+
+    return 0;
+}
+
+queue_t *queue_pop_front (queue_t **queue)
+{
+    if ((queue == NULL) || ((*queue) == NULL)) {
+        return NULL;
+    }
+
+    queue_t *elem = (*queue);
+
+    // Se for o único elemento da fila
+    if (elem->next == elem) {
+        (*queue) = NULL;
+    }
+    else {
+        (*queue) = elem->next;
+        elem->next->prev = elem->prev;
+        elem->prev->next = elem->next;
+    }
+
+    elem->next = NULL;
+    elem->prev = NULL;
+
+    return elem;
 }
 
+int queue_push_front (queue_t **queue, queue_t *elem)
+{
+    if (queue == NULL) {
+        fprintf(stderr, "ERRO queue_push_front: A fila não existe.\n");
+        return -1;
+    }
+
+    if (elem == NULL) {
+        fprintf(stderr, "ERRO: Elemento não existe.\n");
+        return -2;
+    }
+
+    // Um elemento de qualquer fila (inclusive desta) tem ponteiros não nulos
+    if ((elem->next != NULL) || (elem->prev != NULL)) {
+        fprintf(stderr, "ERRO: Elemento está em outra fila.\n");
+        return -3;
+    }
+
+    // Se a fila está vazia
+    if ((*queue) == NULL) {
+        (*queue) = elem;
+        elem->next = elem;
+        elem->prev = elem;
+
+        return 0;
+    }
+
+    // Coloca antes do primeiro e passa a ser o início da fila
+    queue_t *last = (*queue)->prev;
+    last->next = elem;
+    elem->prev = last;
+    (*queue)->prev = elem;
+    elem->next = (*queue);
+    (*queue) = elem;
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Operações extras na fila genérica: emenda, inserção e retirada no início e
+// percurso seguro. Ficam fora de queue.h, que é substituído nos testes.
+
+#ifndef __QUEUE_EXT__
+#define __QUEUE_EXT__
+
+#include "queue.h"
+
+//------------------------------------------------------------------------------
+// Emenda a fila *src inteira no final da fila *dst, em tempo constante; *src
+// fica vazia.
+// Retorno: 0 se sucesso, <0 se ocorreu algum erro
+
+int queue_concat (queue_t **dst, queue_t **src) ;
+
+//------------------------------------------------------------------------------
+// Retira o primeiro elemento da fila, em tempo constante.
+// Retorno: o elemento retirado, ou NULL se a fila não existe ou está vazia
+
+queue_t *queue_pop_front (queue_t **queue) ;
+
+//------------------------------------------------------------------------------
+// Insere um elemento no início da fila, em tempo constante.
+// Condicoes a verificar, gerando msgs de erro: as mesmas de queue_append
+// Retorno: 0 se sucesso, <0 se ocorreu algum erro
+
+int queue_push_front (queue_t **queue, queue_t *elem) ;
+
+//------------------------------------------------------------------------------
+// Percorre a fila "queue" com "elem" (um ponteiro para "type", declarado pela
+// macro), permitindo retirar o elemento corrente da fila ou movê-lo para outra
+// fila dentro do laço. O último elemento é fixado no início do percurso.
+//
+// queue_foreach_safe (task_t, fila, task)
+//    ...
+
+#define queue_foreach_safe(type, queue, elem)                                  \
+   for (type *elem = (type *) (queue),                                         \
+             *elem##_last = elem ? (type *) elem->prev : NULL,                 \
+             *elem##_next = elem ? (type *) elem->next : NULL ;                \
+        elem ;                                                                 \
+        elem = (elem == elem##_last) ? NULL : elem##_next,                     \
+        elem##_next = elem ? (type *) elem->next : NULL)
+
+#endif
@@ -0,0 +1,129 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Fila intrusiva tipada, inteiramente em linha. A macro QUEUE_INLINE gera, para
+// um tipo de elemento com campos "prev" e "next", as operações da fila como
+// funções static inline, sem casts e sem mensagens de erro, de forma que o
+// compilador possa expandi-las dentro do escalonador.
+//
+// Diferente de queue.c, nenhuma operação percorre a fila: o chamador garante
+// que o elemento inserido não está em outra fila e que o elemento retirado
+// pertence à fila informada. A única verificação feita é se o elemento está em
+// alguma fila (next != NULL) ao retirá-lo.
+//
+// QUEUE_INLINE (taskq, task_t)
+//    taskq_append (&fila, task) ;
+//    taskq_remove (&fila, task) ;
+//
+// QUEUE_INLINE_LINK usa outro par de campos, para um elemento que pode estar em
+// duas filas ao mesmo tempo:
+//
+// QUEUE_INLINE_LINK (timerq, task_t, timer_prev, timer_next)
+
+#ifndef __QUEUE_INLINE__
+#define __QUEUE_INLINE__
+
+#define QUEUE_INLINE(name, type) QUEUE_INLINE_LINK (name, type, prev, next)
+
+#define QUEUE_INLINE_LINK(name, type, prev, next)                              \
+                                                                               \
+/* Insere um elemento no final da fila */                                      \
+static inline void name##_append (type **queue, type *elem)                    \
+{                                                                              \
+    type *first = *queue ;                                                     \
+                                                                               \
+    if (!first)                                                                \
+    {                                                                          \
+        elem->prev = elem->next = elem ;                                       \
+        *queue = elem ;                                                        \
+        return ;                                                               \
+    }                                                                          \
+    elem->next = first ;                                                       \
+    elem->prev = first->prev ;                                                 \
+    first->prev->next = elem ;                                                 \
+    first->prev = elem ;                                                       \
+}                                                                              \
+                                                                               \
+/* Insere um elemento no início da fila */                                     \
+static inline void name##_push_front (type **queue, type *elem)                \
+{                                                                              \
+    name##_append (queue, elem) ;                                              \
+    *queue = elem ;                                                            \
+}                                                                              \
+                                                                               \
+/* Insere um elemento antes de pos, que está na fila */                      \
+static inline void name##_insert_before (type **queue, type *pos, type *elem)  \
+{                                                                              \
+    elem->next = pos ;                                                         \
+    elem->prev = pos->prev ;                                                   \
+    pos->prev->next = elem ;                                                   \
+    pos->prev = elem ;                                                         \
+    if (*queue == pos)                                                         \
+        *queue = elem ;                                                        \
+}                                                                              \
+                                                                               \
+/* Retira um elemento da fila; -1 se ele não está em nenhuma fila */           \
+static inline int name##_remove (type **queue, type *elem)                     \
+{                                                                              \
+    if (!elem->next)                                                           \
+        return (-1) ;                                                          \
+                                                                               \
+    if (elem->next == elem)                                                    \
+        *queue = NULL ;                                                        \
+    else                                                                       \
+    {                                                                          \
+        elem->prev->next = elem->next ;                                        \
+        elem->next->prev = elem->prev ;                                        \
+        if (*queue == elem)                                                    \
+            *queue = elem->next ;                                              \
+    }                                                                          \
+    elem->prev = elem->next = NULL ;                                           \
+    return (0) ;                                                               \
+}                                                                              \
+                                                                               \
+/* Retira e devolve o primeiro elemento da fila, ou NULL se ela está vazia */  \
+static inline type *name##_pop_front (type **queue)                            \
+{                                                                              \
+    type *first = *queue ;                                                     \
+                                                                               \
+    if (first)                                                                 \
+        name##_remove (queue, first) ;                                         \
+    return first ;                                                             \
+}                                                                              \
+                                                                               \
+/* Emenda a fila *src inteira no final de *dst; *src fica vazia */             \
+static inline void name##_concat (type **dst, type **src)                      \
+{                                                                              \
+    type *head = *src, *tail ;                                                 \
+                                                                               \
+    if (!head)                                                                 \
+        return ;                                                               \
+    *src = NULL ;                                                              \
+    if (!*dst)                                                                 \
+    {                                                                          \
+        *dst = head ;                                                          \
+        return ;                                                               \
+    }                                                                          \
+    tail = head->prev ;                                                        \
+    head->prev = (*dst)->prev ;                                                \
+    (*dst)->prev->next = head ;                                                \
+    tail->next = *dst ;                                                        \
+    (*dst)->prev = tail ;                                                      \
+}                                                                              \
+                                                                               \
+/* Conta os elementos da fila (percorre a fila) */                             \
+static inline int name##_size (type *queue)                                    \
+{                                                                              \
+    type *elem = queue ;                                                       \
+    int size = 0 ;                                                             \
+                                                                               \
+    if (!queue)                                                                \
+        return 0 ;                                                             \
+    do                                                                         \
+    {                                                                          \
+        size++ ;                                                               \
+        elem = elem->next ;                                                    \
+    } while (elem != queue) ;                                                  \
+    return size ;                                                              \
+}
+
+#endif
@@ -0,0 +1,146 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Compara a fila circular encadeada (queue_inline.h) com o deque em vetor
+// circular (deque_inline.h) com 1 mil, 100 mil e 1 milhão de elementos:
+// percorrer a fila inteira, girar a fila (primeiro vai para o final) e retirar
+// elementos do meio.
+//
+// gcc -O2 -I. testadeque-escala.c -o testadeque-escala
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "queue_inline.h"
+#include "deque_inline.h"
+
+typedef struct elem_t
+{
+   struct elem_t *prev ;
+   struct elem_t *next ;
+   unsigned int pos ;
+   int id ;
+} elem_t ;
+
+QUEUE_INLINE (lista, elem_t)
+DEQUE_TYPE (vetor, elem_t)
+DEQUE_INLINE (vetor, elem_t, pos)
+
+// como assert, mas continua valendo com -DNDEBUG
+#define confere(cond)                                                          \
+   do {                                                                        \
+      if (!(cond))                                                             \
+      {                                                                        \
+         fprintf (stderr, "ERRO linha %d: %s\n", __LINE__, #cond) ;            \
+         exit (1) ;                                                            \
+      }                                                                        \
+   } while (0)
+
+// tempo atual em segundos
+double agora ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return ts.tv_sec + ts.tv_nsec / 1e9 ;
+}
+
+//------------------------------------------------------------------------------
+
+void mede (int n)
+{
+   elem_t *item, *lista = NULL, *e ;
+   vetor_t vetor = {0} ;
+   long soma_l = 0, soma_v = 0 ;
+   double t, scan_l, scan_v, giro_l, giro_v, meio_l, meio_v ;
+   unsigned int p ;
+   int i, voltas = 100000000 / n ;
+
+   // os elementos são embaralhados na memória, como TCBs alocados ao longo
+   // da execução
+   item = calloc (n, sizeof (elem_t)) ;
+   int *ordem = malloc (n * sizeof (int)) ;
+   confere (item && ordem) ;
+   for (i = 0; i < n; i++)
+      ordem[i] = i ;
+   for (i = n - 1; i > 0; i--)
+   {
+      int j = random () % (i + 1), aux = ordem[i] ;
+      ordem[i] = ordem[j] ;
+      ordem[j] = aux ;
+   }
+
+   for (i = 0; i < n; i++)
+   {
+      item[ordem[i]].id = i ;
+      lista_append (&lista, &item[ordem[i]]) ;
+   }
+
+   // percurso
+   t = agora () ;
+   for (int v = 0; v < voltas / 10 + 1; v++)
+   {
+      e = lista ;
+      do
+      {
+         soma_l += e->id ;
+         e = e->next ;
+      } while (e != lista) ;
+   }
+   scan_l = (agora () - t) / ((voltas / 10 + 1) * (double) n) ;
+
+   for (i = 0; i < n; i++)
+      confere (vetor_push_back (&vetor, &item[ordem[i]]) == 0) ;
+
+   t = agora () ;
+   for (int v = 0; v < voltas / 10 + 1; v++)
+      for (p = vetor.head; p != vetor.tail; p++)
+         if ((e = vetor.slot[p & (vetor.size - 1)]))
+            soma_v += e->id ;
+   scan_v = (agora () - t) / ((voltas / 10 + 1) * (double) n) ;
+   confere (soma_l == soma_v) ;
+
+   // giro: n giros, cada elemento passa uma vez pelo início
+   t = agora () ;
+   for (i = 0; i < n; i++)
+   {
+      e = lista ;
+      lista_remove (&lista, e) ;
+      lista_append (&lista, e) ;
+   }
+   giro_l = (agora () - t) / n ;
+
+   t = agora () ;
+   for (i = 0; i < n; i++)
+      vetor_rotate (&vetor) ;
+   giro_v = (agora () - t) / n ;
+   confere (lista == vetor_first (&vetor)) ;
+
+   // retirada do meio: metade dos elementos, em ordem aleatória
+   t = agora () ;
+   for (i = 0; i < n / 2; i++)
+      lista_remove (&lista, &item[ordem[(i * 7919L) % n]]) ;
+   meio_l = (agora () - t) / (n / 2) ;
+
+   t = agora () ;
+   for (i = 0; i < n / 2; i++)
+      vetor_remove (&vetor, &item[ordem[(i * 7919L) % n]]) ;
+   meio_v = (agora () - t) / (n / 2) ;
+   confere (lista_size (lista) == (int) vetor_count (&vetor)) ;
+
+   printf ("%8d  percurso %6.2f / %6.2f ns  giro %6.2f / %6.2f ns  meio %6.2f / %6.2f ns\n",
+           n, scan_l * 1e9, scan_v * 1e9, giro_l * 1e9, giro_v * 1e9,
+           meio_l * 1e9, meio_v * 1e9) ;
+
+   free (vetor.slot) ;
+   free (ordem) ;
+   free (item) ;
+}
+
+int main ()
+{
+   printf ("elementos  (fila encadeada / deque, por elemento)\n") ;
+   mede (1000) ;
+   mede (100000) ;
+   mede (1000000) ;
+   return 0 ;
+}
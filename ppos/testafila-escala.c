@@ -0,0 +1,276 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Variante em escala de testafila.c: confere a fila em linha (queue_inline.h)
+// com N elementos e as operações extras de queue.c (queue_ext.h), e compara o
+// tempo da fila em linha com o de queue.c nas mesmas operações.
+//
+// gcc -O2 -DNDEBUG -I. queue.c testafila-escala.c -o testafila-escala
+// ./testafila-escala [N]
+//
+// Sem -DNDEBUG, queue.c percorre a fila a cada inserção e remoção; use um N
+// pequeno nesse caso.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "queue.h"
+#include "queue_ext.h"
+#include "queue_inline.h"
+
+#define EXTRAS 100                // elementos usados nos testes de queue_ext.h
+
+typedef struct filaint_t
+{
+   struct filaint_t *prev ;  // ptr para usar cast com queue_t
+   struct filaint_t *next ;  // ptr para usar cast com queue_t
+   int id ;
+} filaint_t ;
+
+QUEUE_INLINE (filaint, filaint_t)
+
+// como assert, mas continua valendo com -DNDEBUG (necessário para queue.c
+// executar em tempo constante)
+#define confere(cond)                                                          \
+   do {                                                                        \
+      if (!(cond))                                                             \
+      {                                                                        \
+         fprintf (stderr, "ERRO linha %d: %s\n", __LINE__, #cond) ;            \
+         exit (1) ;                                                            \
+      }                                                                        \
+   } while (0)
+
+filaint_t *item ;
+int *ordem ;
+int N ;
+
+//------------------------------------------------------------------------------
+
+// retorna 1 se a estrutura da fila está correta, 0 senão
+int fila_correta (filaint_t *fila)
+{
+   filaint_t *aux = fila ;
+
+   if (!fila)
+      return 1 ;
+
+   do
+   {
+      if (aux->next->prev != aux || aux->prev->next != aux)
+         return 0 ;
+      aux = aux->next ;
+   } while (aux != fila) ;
+
+   return 1 ;
+}
+
+// tempo atual em segundos
+double agora ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return ts.tv_sec + ts.tv_nsec / 1e9 ;
+}
+
+//------------------------------------------------------------------------------
+
+// confere as operações de queue_ext.h sobre queue.c, inclusive com filas
+// vazias e a emenda de uma fila nela mesma
+void testa_extras ()
+{
+   filaint_t *fila0 = NULL, *fila1 = NULL, *elem ;
+   int i, visitados, movidos ;
+
+   // retirada do início de fila inexistente ou vazia
+   confere (queue_pop_front (NULL) == NULL) ;
+   confere (queue_pop_front ((queue_t **) &fila0) == NULL) ;
+
+   // inserção no início: a fila fica em ordem inversa
+   for (i = 0; i < EXTRAS; i++)
+   {
+      confere (queue_push_front ((queue_t **) &fila0, (queue_t *) &item[i]) == 0) ;
+      confere (fila0 == &item[i]) ;
+   }
+   confere (queue_size ((queue_t *) fila0) == EXTRAS && fila_correta (fila0)) ;
+   confere (queue_push_front ((queue_t **) &fila1, (queue_t *) &item[0]) < 0) ;
+   confere (queue_push_front (NULL, (queue_t *) &item[EXTRAS]) < 0) ;
+   confere (queue_push_front ((queue_t **) &fila1, NULL) < 0) ;
+   confere (!fila1) ;
+
+   // retirada do início: ordem inversa da inserção, elementos desligados
+   for (i = EXTRAS - 1; i >= EXTRAS / 2; i--)
+   {
+      elem = (filaint_t *) queue_pop_front ((queue_t **) &fila0) ;
+      confere (elem == &item[i] && !elem->next && !elem->prev) ;
+      confere (queue_append ((queue_t **) &fila1, (queue_t *) elem) == 0) ;
+   }
+   confere (fila_correta (fila0) && fila_correta (fila1)) ;
+
+   // emendas com filas vazias e da fila nela mesma não mudam nada
+   confere (queue_concat (NULL, (queue_t **) &fila1) < 0) ;
+   confere (queue_concat ((queue_t **) &fila0, NULL) < 0) ;
+   elem = NULL ;
+   confere (queue_concat ((queue_t **) &fila0, (queue_t **) &elem) == 0) ;
+   confere (!elem && queue_size ((queue_t *) fila0) == EXTRAS / 2) ;
+   confere (queue_concat ((queue_t **) &fila1, (queue_t **) &fila1) == 0) ;
+   confere (fila1 == &item[EXTRAS - 1] && queue_size ((queue_t *) fila1) == EXTRAS - EXTRAS / 2) ;
+   confere (fila_correta (fila1)) ;
+
+   // emenda numa fila vazia: a fila de origem passa inteira
+   confere (queue_concat ((queue_t **) &elem, (queue_t **) &fila1) == 0) ;
+   confere (!fila1 && elem == &item[EXTRAS - 1]) ;
+   fila1 = elem ;
+
+   // emenda de duas filas: 49..0 seguido de 99..50
+   confere (queue_concat ((queue_t **) &fila0, (queue_t **) &fila1) == 0) ;
+   confere (!fila1 && queue_size ((queue_t *) fila0) == EXTRAS && fila_correta (fila0)) ;
+   elem = fila0 ;
+   for (i = 0; i < EXTRAS; i++, elem = elem->next)
+      confere (elem->id == (i < EXTRAS / 2 ? EXTRAS / 2 - 1 - i : EXTRAS - 1 - (i - EXTRAS / 2))) ;
+
+   // percurso seguro de fila vazia não executa o laço
+   visitados = 0 ;
+   queue_foreach_safe (filaint_t, fila1, e)
+      visitados++ ;
+   confere (!visitados) ;
+
+   // percurso seguro movendo os pares para outra fila e retirando os ímpares
+   visitados = movidos = 0 ;
+   queue_foreach_safe (filaint_t, fila0, e)
+   {
+      visitados++ ;
+      confere (queue_remove ((queue_t **) &fila0, (queue_t *) e) == 0) ;
+      if (e->id % 2 == 0)
+      {
+         confere (queue_push_front ((queue_t **) &fila1, (queue_t *) e) == 0) ;
+         movidos++ ;
+      }
+   }
+   confere (visitados == EXTRAS && movidos == EXTRAS / 2 && !fila0) ;
+   confere (queue_size ((queue_t *) fila1) == EXTRAS / 2 && fila_correta (fila1)) ;
+
+   // percurso seguro de um único elemento, retirando-o
+   elem = (filaint_t *) queue_pop_front ((queue_t **) &fila1) ;
+   confere (queue_append ((queue_t **) &fila0, (queue_t *) elem) == 0) ;
+   visitados = 0 ;
+   queue_foreach_safe (filaint_t, fila0, e)
+   {
+      visitados++ ;
+      confere (queue_remove ((queue_t **) &fila0, (queue_t *) e) == 0) ;
+   }
+   confere (visitados == 1 && !fila0) ;
+
+   while (queue_pop_front ((queue_t **) &fila1)) ;
+   confere (!fila1) ;
+}
+
+//------------------------------------------------------------------------------
+
+// insere todos, retira em ordem aleatória, insere de novo e retira do início
+double rodada_generica ()
+{
+   filaint_t *fila = NULL ;
+   double inicio = agora () ;
+   int i ;
+
+   for (i = 0; i < N; i++)
+      queue_append ((queue_t **) &fila, (queue_t *) &item[i]) ;
+   for (i = 0; i < N; i++)
+      queue_remove ((queue_t **) &fila, (queue_t *) &item[ordem[i]]) ;
+   for (i = 0; i < N; i++)
+      queue_append ((queue_t **) &fila, (queue_t *) &item[i]) ;
+   while (fila)
+      queue_remove ((queue_t **) &fila, (queue_t *) fila) ;
+
+   return agora () - inicio ;
+}
+
+double rodada_inline ()
+{
+   filaint_t *fila = NULL ;
+   double inicio = agora () ;
+   int i ;
+
+   for (i = 0; i < N; i++)
+      filaint_append (&fila, &item[i]) ;
+   for (i = 0; i < N; i++)
+      filaint_remove (&fila, &item[ordem[i]]) ;
+   for (i = 0; i < N; i++)
+      filaint_append (&fila, &item[i]) ;
+   while (fila)
+      filaint_pop_front (&fila) ;
+
+   return agora () - inicio ;
+}
+
+//------------------------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+   filaint_t *fila0 = NULL, *fila1 = NULL ;
+   double generica, em_linha ;
+   int i, j, aux ;
+
+   N = (argc > 1) ? atoi (argv[1]) : 100000 ;
+   item = calloc (N > EXTRAS ? N : EXTRAS + 1, sizeof (filaint_t)) ;
+   ordem = malloc (N * sizeof (int)) ;
+   confere (item && ordem && N > 1) ;
+
+   for (i = 0; i < N || i <= EXTRAS; i++)
+      item[i].id = i ;
+   for (i = 0; i < N; i++)
+      ordem[i] = i ;
+   for (i = N - 1; i > 0; i--)
+   {
+      j = random () % (i + 1) ;
+      aux = ordem[i] ; ordem[i] = ordem[j] ; ordem[j] = aux ;
+   }
+
+   // PARTE 1: correção da fila em linha ======================================
+
+   printf ("Testando a fila em linha com %d elementos...\n", N) ;
+
+   for (i = 0; i < N; i++)
+      filaint_append (&fila0, &item[i]) ;
+   confere (filaint_size (fila0) == N && fila_correta (fila0)) ;
+   for (i = 0; i < N; i++, fila0 = fila0->next)
+      confere (fila0->id == i) ;
+
+   // metade dos elementos, em ordem aleatória, vai para a outra fila
+   for (i = 0; i < N / 2; i++)
+   {
+      confere (filaint_remove (&fila0, &item[ordem[i]]) == 0) ;
+      confere (filaint_remove (&fila0, &item[ordem[i]]) < 0) ;
+      filaint_push_front (&fila1, &item[ordem[i]]) ;
+      confere (fila1 == &item[ordem[i]]) ;
+   }
+   confere (filaint_size (fila0) == N - N / 2 && fila_correta (fila0)) ;
+   confere (filaint_size (fila1) == N / 2 && fila_correta (fila1)) ;
+
+   filaint_concat (&fila0, &fila1) ;
+   confere (!fila1 && filaint_size (fila0) == N && fila_correta (fila0)) ;
+
+   while ((fila1 = filaint_pop_front (&fila0)))
+      confere (!fila1->next && !fila1->prev) ;
+   confere (!fila0) ;
+
+   printf ("Testes da fila em linha funcionaram!\n") ;
+
+   // PARTE 2: operações extras de queue.c =====================================
+
+   printf ("Testando queue_ext.h com %d elementos...\n", EXTRAS) ;
+   testa_extras () ;
+   printf ("Testes de queue_ext.h funcionaram!\n") ;
+
+   // PARTE 3: desempenho =====================================================
+
+   generica = rodada_generica () ;
+   em_linha = rodada_inline () ;
+
+   printf ("queue.c:        %8.1f ns/op\n", generica * 1e9 / (4.0 * N)) ;
+   printf ("queue_inline.h: %8.1f ns/op\n", em_linha * 1e9 / (4.0 * N)) ;
+
+   free (item) ;
+   free (ordem) ;
+   return 0 ;
+}
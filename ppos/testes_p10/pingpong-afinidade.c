@@ -0,0 +1,151 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Latência de acordar: Ping e Pong trocam uma ficha (por semáforos e por uma
+// fila de mensagens) enquanto OCUPADAS tarefas de mesma prioridade usam o
+// processador o tempo todo. Sem WAKE_AFFINE cada passagem espera as ocupadas
+// gastarem seus quanta; compilado com -DWAKE_AFFINE=1, quem acorda troca
+// direto para a tarefa acordada e cada passagem custa uma troca de contexto.
+// Mede também o tempo entre o fim de uma tarefa e o retorno de task_join.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define OCUPADAS 4
+#define DURACAO 500               // ms de cada rodada
+
+task_t Ping, Pong, Ocupada[OCUPADAS], Filha ;
+semaphore_t s_ping, s_pong ;
+mqueue_t q_ping, q_pong ;
+volatile int fim, modo ;
+int idas ;
+unsigned int saida_filha ;
+
+void ocupada (void *arg)
+{
+   volatile int i ;
+
+   while (!fim)
+      for (i = 0; i < 1000; i++) ;
+   task_exit (0) ;
+}
+
+void ping (void *arg)
+{
+   unsigned int inicio = systime () ;
+   int ficha = 0 ;
+
+   while (systime () - inicio < DURACAO)
+   {
+      if (modo == 0)
+      {
+         sem_up (&s_pong) ;
+         sem_down (&s_ping) ;
+      }
+      else
+      {
+         mqueue_send (&q_pong, &ficha) ;
+         mqueue_recv (&q_ping, &ficha) ;
+      }
+      idas++ ;
+   }
+
+   // ficha negativa encerra Pong
+   ficha = -1 ;
+   if (modo == 0)
+   {
+      fim = 1 ;
+      sem_up (&s_pong) ;
+   }
+   else
+      mqueue_send (&q_pong, &ficha) ;
+   task_exit (0) ;
+}
+
+void pong (void *arg)
+{
+   int ficha ;
+
+   while (1)
+   {
+      if (modo == 0)
+      {
+         sem_down (&s_pong) ;
+         if (fim)
+            break ;
+         sem_up (&s_ping) ;
+      }
+      else
+      {
+         mqueue_recv (&q_pong, &ficha) ;
+         if (ficha < 0)
+            break ;
+         ficha++ ;
+         mqueue_send (&q_ping, &ficha) ;
+      }
+   }
+   task_exit (0) ;
+}
+
+void filha (void *arg)
+{
+   saida_filha = systime () ;
+   task_exit (0) ;
+}
+
+void rodada (char *nome)
+{
+   int i ;
+
+   fim = 0 ;
+   idas = 0 ;
+   for (i = 0; i < OCUPADAS; i++)
+      task_create (&Ocupada[i], ocupada, NULL) ;
+   task_create (&Pong, pong, NULL) ;
+   task_create (&Ping, ping, NULL) ;
+
+   task_join (&Ping) ;
+   task_join (&Pong) ;
+   fim = 1 ;
+   for (i = 0; i < OCUPADAS; i++)
+      task_join (&Ocupada[i]) ;
+
+   printf ("%-10s %7d idas e voltas em %d ms, %7d us por ida e volta\n", nome,
+           idas, DURACAO, idas ? DURACAO * 1000 / idas : 0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned int espera ;
+   int i ;
+
+   ppos_init () ;
+
+   sem_create (&s_ping, 0) ;
+   sem_create (&s_pong, 0) ;
+   mqueue_create (&q_ping, 1, sizeof (int)) ;
+   mqueue_create (&q_pong, 1, sizeof (int)) ;
+
+   modo = 0 ;
+   rodada ("semaforos") ;
+   modo = 1 ;
+   rodada ("mqueue") ;
+
+   // main espera uma filha terminar enquanto as ocupadas disputam o processador
+   fim = 0 ;
+   for (i = 0; i < OCUPADAS; i++)
+      task_create (&Ocupada[i], ocupada, NULL) ;
+   task_create (&Filha, filha, NULL) ;
+   task_join (&Filha) ;
+   espera = systime () - saida_filha ;
+   fim = 1 ;
+   for (i = 0; i < OCUPADAS; i++)
+      task_join (&Ocupada[i]) ;
+   printf ("task_join retornou %u ms apos o fim da filha\n", espera) ;
+
+   sem_destroy (&s_ping) ;
+   sem_destroy (&s_pong) ;
+   mqueue_destroy (&q_ping) ;
+   mqueue_destroy (&q_pong) ;
+   task_exit (0) ;
+}
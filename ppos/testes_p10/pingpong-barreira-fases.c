@@ -0,0 +1,96 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Tarefas organizadas em fases: TAREFAS tarefas passam FASES vezes pela mesma
+// barreira, sem reinicializá-la. Em cada fase todas as tarefas incrementam o
+// contador da fase e, depois da barreira, conferem que ele chegou a TAREFAS.
+// Depois EXCESSO tarefas passam por uma barreira de 2: uma tarefa liberada pode
+// ver a barreira ser liberada outras vezes antes de executar, e ainda assim deve
+// receber 0. Ao final, uma tarefa fica presa numa barreira destruída e deve
+// receber -1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define TAREFAS 300
+#define FASES 100
+#define EXCESSO 10
+
+task_t Tarefa[TAREFAS], Presa ;
+barrier_t b_fases, b_dupla, b_destruida ;
+int chegadas[FASES] ;
+int erros ;
+
+void tarefa (void *arg)
+{
+   int fase ;
+
+   for (fase = 0; fase < FASES; fase++)
+   {
+      chegadas[fase]++ ;
+      if (barrier_join (&b_fases) < 0)
+         erros++ ;
+      if (chegadas[fase] != TAREFAS)
+         erros++ ;
+   }
+   task_exit (0) ;
+}
+
+void excesso (void *arg)
+{
+   int fase ;
+
+   for (fase = 0; fase < FASES; fase++)
+      if (barrier_join (&b_dupla) < 0)
+         erros++ ;
+   task_exit (0) ;
+}
+
+void presa (void *arg)
+{
+   task_exit (barrier_join (&b_destruida)) ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned int inicio, fim ;
+   int i ;
+
+   ppos_init () ;
+
+   barrier_create (&b_fases, TAREFAS + 1) ;
+   barrier_create (&b_destruida, 2) ;
+
+   inicio = systime () ;
+   for (i = 0; i < TAREFAS; i++)
+      task_create (&Tarefa[i], tarefa, NULL) ;
+
+   // main também participa de cada fase
+   for (i = 0; i < FASES; i++)
+      if (barrier_join (&b_fases) < 0)
+         erros++ ;
+   for (i = 0; i < TAREFAS; i++)
+      task_join (&Tarefa[i]) ;
+   fim = systime () ;
+
+   printf ("%d fases com %d tarefas em %u ms, %d erros\n", FASES, TAREFAS + 1,
+           fim - inicio, erros) ;
+
+   // mais tarefas que o tamanho da barreira (o total de chegadas é par)
+   erros = 0 ;
+   barrier_create (&b_dupla, 2) ;
+   for (i = 0; i < EXCESSO; i++)
+      task_create (&Tarefa[i], excesso, NULL) ;
+   for (i = 0; i < EXCESSO; i++)
+      task_join (&Tarefa[i]) ;
+   printf ("%d tarefas numa barreira de 2: %d erros\n", EXCESSO, erros) ;
+   barrier_destroy (&b_dupla) ;
+
+   task_create (&Presa, presa, NULL) ;
+   task_sleep (10) ;
+   barrier_destroy (&b_destruida) ;
+   printf ("barreira destruida: barrier_join retornou %d\n", task_join (&Presa)) ;
+
+   barrier_destroy (&b_fases) ;
+   task_exit (0) ;
+}
@@ -0,0 +1,188 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Muitos consumidores numa mesma fila: a produtora coloca LOTE itens de uma vez
+// e acorda todos os CONSUMIDORES. Com condvar_broadcast as tarefas passam
+// direto da condição para a fila do mutex; a versão ingênua (semáforo + mutex)
+// acorda todas elas, que em seguida bloqueiam de novo no mutex enquanto outra
+// consumidora o detém (a seção crítica cede o processador, como se fosse
+// preemptada). Compara o tempo e as ativações das consumidoras; a soma
+// consumida deve ser a produzida.
+// Ao final, confere o prazo e a destruição da condição.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define CONSUMIDORES 100
+#define LOTE 100
+#define LOTES 2000
+
+task_t Produtora, Consumidora[CONSUMIDORES], Presa ;
+mutex_t m_fila ;
+condvar_t c_itens, c_vazia, c_destruida ;
+semaphore_t s_itens, s_vazia ;
+int esperam_itens, esperam_vazia ;
+int itens, fim, ingenua ;
+long long soma_produzida, soma_consumida ;
+unsigned int ativacoes ;
+
+// espera e acorda; na versão ingênua: a tarefa acordada disputa o mutex depois
+void espera (condvar_t *c, semaphore_t *s, int *esperam)
+{
+   if (!ingenua)
+   {
+      condvar_wait (c, &m_fila) ;
+      return ;
+   }
+   (*esperam)++ ;
+   mutex_unlock (&m_fila) ;
+   sem_down (s) ;
+   mutex_lock (&m_fila) ;
+}
+
+void acorda_todas (condvar_t *c, semaphore_t *s, int *esperam)
+{
+   if (!ingenua)
+   {
+      condvar_broadcast (c) ;
+      return ;
+   }
+   for (; *esperam > 0; (*esperam)--)
+      sem_up (s) ;
+}
+
+void acorda_uma (condvar_t *c, semaphore_t *s, int *esperam)
+{
+   if (!ingenua)
+   {
+      condvar_signal (c) ;
+      return ;
+   }
+   if (*esperam > 0)
+   {
+      (*esperam)-- ;
+      sem_up (s) ;
+   }
+}
+
+void produtora (void *arg)
+{
+   int i, j ;
+
+   for (i = 0; i < LOTES; i++)
+   {
+      mutex_lock (&m_fila) ;
+      while (itens > 0)
+         espera (&c_vazia, &s_vazia, &esperam_vazia) ;
+      for (j = 1; j <= LOTE; j++)
+         soma_produzida += j ;
+      itens = LOTE ;
+      acorda_todas (&c_itens, &s_itens, &esperam_itens) ;
+      mutex_unlock (&m_fila) ;
+   }
+
+   mutex_lock (&m_fila) ;
+   while (itens > 0)
+      espera (&c_vazia, &s_vazia, &esperam_vazia) ;
+   fim = 1 ;
+   acorda_todas (&c_itens, &s_itens, &esperam_itens) ;
+   mutex_unlock (&m_fila) ;
+   task_exit (0) ;
+}
+
+void consumidora (void *arg)
+{
+   task_t *eu = arg ;
+   int item ;
+
+   while (1)
+   {
+      mutex_lock (&m_fila) ;
+      while (!itens && !fim)
+         espera (&c_itens, &s_itens, &esperam_itens) ;
+      if (!itens)
+      {
+         mutex_unlock (&m_fila) ;
+         break ;
+      }
+      item = itens-- ;
+      task_yield () ;
+      if (!itens)
+         acorda_uma (&c_vazia, &s_vazia, &esperam_vazia) ;
+      mutex_unlock (&m_fila) ;
+      soma_consumida += item ;
+   }
+
+   ativacoes += eu->activations ;
+   task_exit (0) ;
+}
+
+void presa (void *arg)
+{
+   int result ;
+
+   mutex_lock (&m_fila) ;
+   result = condvar_wait (&c_destruida, &m_fila) ;
+   if (mutex_unlock (&m_fila) < 0)
+      result = 1 ;
+   task_exit (result) ;
+}
+
+void rodada (char *nome)
+{
+   unsigned int inicio ;
+   int i ;
+
+   itens = fim = 0 ;
+   soma_produzida = soma_consumida = 0 ;
+   ativacoes = 0 ;
+   inicio = systime () ;
+
+   for (i = 0; i < CONSUMIDORES; i++)
+      task_create (&Consumidora[i], consumidora, &Consumidora[i]) ;
+   task_create (&Produtora, produtora, NULL) ;
+   task_join (&Produtora) ;
+   for (i = 0; i < CONSUMIDORES; i++)
+      task_join (&Consumidora[i]) ;
+
+   printf ("%-18s %d itens em %4u ms, %7u ativacoes, soma %s\n", nome,
+           LOTE * LOTES, systime () - inicio, ativacoes,
+           soma_produzida == soma_consumida ? "ok" : "ERRO") ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned int inicio ;
+   int result ;
+
+   ppos_init () ;
+
+   mutex_create (&m_fila) ;
+   condvar_create (&c_itens) ;
+   condvar_create (&c_vazia) ;
+   condvar_create (&c_destruida) ;
+   sem_create (&s_itens, 0) ;
+   sem_create (&s_vazia, 0) ;
+
+   ingenua = 1 ;
+   rodada ("semaforo + mutex") ;
+   ingenua = 0 ;
+   rodada ("condvar_broadcast") ;
+
+   // o prazo vence, mas a tarefa volta com o mutex
+   mutex_lock (&m_fila) ;
+   inicio = systime () ;
+   result = condvar_wait_timeout (&c_itens, &m_fila, 30) ;
+   printf ("condvar_wait_timeout retornou %d apos %u ms: %s\n", result,
+           systime () - inicio, result == -2 && !mutex_unlock (&m_fila) ? "ok" : "ERRO") ;
+
+   task_create (&Presa, presa, NULL) ;
+   task_sleep (10) ;
+   condvar_destroy (&c_destruida) ;
+   printf ("condicao destruida: condvar_wait retornou %d\n", task_join (&Presa)) ;
+
+   condvar_destroy (&c_itens) ;
+   condvar_destroy (&c_vazia) ;
+   mutex_destroy (&m_fila) ;
+   task_exit (0) ;
+}
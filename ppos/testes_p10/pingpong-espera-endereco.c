@@ -0,0 +1,118 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Objetos de sincronização do usuário sobre ppos_wait/ppos_wake: uma trava de
+// contagem (latch) que TAREFAS tarefas decrementam e main espera, e uma
+// bandeira que libera TAREFAS tarefas de uma vez. Depois ESPERAS tarefas
+// esperam cada uma em seu endereço e são acordadas uma a uma (cada ppos_wake
+// percorre só uma fila da tabela); por fim, mede o custo de ppos_wake sem
+// ninguém esperando e confere o prazo.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define TAREFAS 100
+#define ESPERAS 5000
+#define REPETICOES 1000000
+
+task_t Tarefa[TAREFAS], Espera[ESPERAS] ;
+int contagem, bandeira, liberadas ;
+int endereco[ESPERAS], acordou[ESPERAS], ordem ;
+int erros ;
+
+// trava de contagem: sem estado no núcleo, só o inteiro
+void latch_down (int *latch)
+{
+   if (__atomic_sub_fetch (latch, 1, __ATOMIC_SEQ_CST) == 0)
+      ppos_wake (latch, -1) ;
+}
+
+void latch_wait (int *latch)
+{
+   int valor ;
+
+   while ((valor = __atomic_load_n (latch, __ATOMIC_SEQ_CST)) > 0)
+      ppos_wait (latch, valor) ;
+}
+
+void tarefa (void *arg)
+{
+   // espera a bandeira, depois conta na trava
+   while (!__atomic_load_n (&bandeira, __ATOMIC_SEQ_CST))
+      ppos_wait (&bandeira, 0) ;
+   __atomic_add_fetch (&liberadas, 1, __ATOMIC_SEQ_CST) ;
+   task_yield () ;
+   latch_down (&contagem) ;
+   task_exit (0) ;
+}
+
+void espera (void *arg)
+{
+   int i = (long) arg ;
+
+   while (!endereco[i])
+      ppos_wait (&endereco[i], 0) ;
+   if (ordem++ != i)
+      erros++ ;
+   acordou[i] = 1 ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned int inicio ;
+   long i, j ;
+   int result, acordadas ;
+
+   ppos_init () ;
+
+   // bandeira e trava de contagem
+   contagem = TAREFAS ;
+   for (i = 0; i < TAREFAS; i++)
+      task_create (&Tarefa[i], tarefa, NULL) ;
+   task_sleep (10) ;
+   printf ("antes da bandeira: %d tarefas liberadas\n", liberadas) ;
+   bandeira = 1 ;
+   acordadas = ppos_wake (&bandeira, -1) ;
+   latch_wait (&contagem) ;
+   printf ("bandeira acordou %d tarefas; trava de contagem chegou a %d com %d liberadas\n",
+           acordadas, contagem, liberadas) ;
+   for (i = 0; i < TAREFAS; i++)
+      task_join (&Tarefa[i]) ;
+
+   // muitas esperas em endereços distintos, acordadas uma a uma
+   for (i = 0; i < ESPERAS; i++)
+      task_create (&Espera[i], espera, (void *) i) ;
+   task_sleep (10) ;
+   inicio = systime () ;
+   for (i = 0; i < ESPERAS; i++)
+   {
+      endereco[i] = 1 ;
+      if (ppos_wake (&endereco[i], 1) != 1)
+         erros++ ;
+      for (j = 0; j < 10 && !acordou[i]; j++)
+         task_yield () ;
+      if (!acordou[i])
+         erros++ ;
+   }
+   printf ("%d esperas acordadas uma a uma em %u ms, %d erros\n", ESPERAS,
+           systime () - inicio, erros) ;
+   for (i = 0; i < ESPERAS; i++)
+      task_join (&Espera[i]) ;
+
+   // sem ninguém esperando, ppos_wake só olha uma fila vazia
+   inicio = systime () ;
+   for (i = 0; i < REPETICOES; i++)
+      ppos_wake (&bandeira, 1) ;
+   printf ("%d ppos_wake sem espera em %u ms\n", REPETICOES, systime () - inicio) ;
+
+   inicio = systime () ;
+   result = ppos_wait_timeout (&bandeira, 1, 30) ;
+   printf ("ppos_wait_timeout retornou %d apos %u ms: %s\n", result,
+           systime () - inicio, result == -2 ? "ok" : "ERRO") ;
+   result = ppos_wait (&bandeira, 0) ;
+   printf ("ppos_wait com valor diferente retornou %d: %s\n", result,
+           result == -3 ? "ok" : "ERRO") ;
+
+   task_exit (0) ;
+}
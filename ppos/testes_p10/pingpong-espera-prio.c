@@ -0,0 +1,204 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Ordem das filas de espera: FUNDO tarefas de prioridade 20 esperam um recurso
+// (semáforo, mutex ou ficha numa fila de mensagens) e depois delas chega Alta,
+// de prioridade -20. Cada tarefa usa o recurso por algum tempo e o passa
+// adiante. Em WAIT_FIFO, Alta é atendida depois de todas as de fundo; em
+// WAIT_PRIO, é a primeira. Mostra a posição e a espera de Alta em cada caso.
+// Por fim, uma tarefa que detém um mutex e espera num semáforo WAIT_PRIO herda
+// a prioridade de quem pede o mutex: a fila do semáforo continua em ordem, e
+// ela passa a executar com a herdada quando é acordada.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define FUNDO 20
+#define TRABALHO 1000
+
+task_t Fundo[FUNDO], Alta ;
+semaphore_t s_recurso ;
+mutex_t m_recurso ;
+mqueue_t q_recurso ;
+int modo, atendidas, posicao_alta ;
+unsigned int espera_alta ;
+int ordem[4], acordadas ;
+
+// simula um processamento pesado
+int hardwork (int n)
+{
+   int i, j, soma ;
+
+   soma = 0 ;
+   for (i=0; i<n; i++)
+      for (j=0; j<n; j++)
+         soma += j ;
+   return (soma) ;
+}
+
+void cliente (void *arg)
+{
+   unsigned int inicio = systime () ;
+   int ficha, posicao ;
+
+   switch (modo)
+   {
+   case 0: sem_down (&s_recurso) ; break ;
+   case 1: mutex_lock (&m_recurso) ; break ;
+   case 2: mqueue_recv (&q_recurso, &ficha) ; break ;
+   }
+
+   posicao = atendidas++ ;
+   if (arg)
+   {
+      posicao_alta = posicao ;
+      espera_alta = systime () - inicio ;
+   }
+   hardwork (TRABALHO) ;
+
+   switch (modo)
+   {
+   case 0: sem_up (&s_recurso) ; break ;
+   case 1: mutex_unlock (&m_recurso) ; break ;
+   case 2: mqueue_send (&q_recurso, &ficha) ; break ;
+   }
+   task_exit (0) ;
+}
+
+// espera no semáforo e anota a ordem em que foi acordada; a dona do mutex o
+// detém enquanto espera
+void espera_semaforo (void *arg)
+{
+   long id = (long) arg ;
+
+   if (id == 3)
+      mutex_lock (&m_recurso) ;
+   sem_down (&s_recurso) ;
+   ordem[acordadas++] = id ;
+   if (id == 3)
+   {
+      printf ("dona acordada com prioridade %d: %s\n", Fundo[3].prio_dinamic,
+              Fundo[3].prio_dinamic == -20 ? "ok" : "ERRO") ;
+      mutex_unlock (&m_recurso) ;
+   }
+   task_exit (0) ;
+}
+
+void pede_mutex (void *arg)
+{
+   mutex_lock (&m_recurso) ;
+   mutex_unlock (&m_recurso) ;
+   task_exit (0) ;
+}
+
+// 0, 1 e 3 (a dona do mutex, de prioridade 10) esperam no semáforo; Alta pede
+// o mutex e a dona herda -20; depois chega 2, de prioridade 7, que deve ficar
+// à frente da dona na fila
+void heranca_na_fila ()
+{
+   int prio[4] = {0, 5, 7, 10} ;
+   long i ;
+
+   sem_create (&s_recurso, 0) ;
+   sem_setpolicy (&s_recurso, WAIT_PRIO) ;
+   mutex_create (&m_recurso) ;
+   for (i = 0; i < 4; i += (i == 1) ? 2 : 1)
+   {
+      task_create (&Fundo[i], espera_semaforo, (void *) i) ;
+      task_setprio (&Fundo[i], prio[i]) ;
+   }
+   task_sleep (10) ;
+   task_create (&Alta, pede_mutex, NULL) ;
+   task_setprio (&Alta, -20) ;
+   task_sleep (10) ;
+   task_create (&Fundo[2], espera_semaforo, (void *) 2L) ;
+   task_setprio (&Fundo[2], prio[2]) ;
+   task_sleep (10) ;
+
+   // uma por vez, para que a ordem anotada seja a da fila
+   for (i = 0; i < 4; i++)
+   {
+      sem_up (&s_recurso) ;
+      task_sleep (5) ;
+   }
+   task_join (&Alta) ;
+   for (i = 0; i < 4; i++)
+      task_join (&Fundo[i]) ;
+   printf ("ordem da fila com a dona herdando: %d %d %d %d: %s\n", ordem[0], ordem[1],
+           ordem[2], ordem[3],
+           ordem[0] == 0 && ordem[1] == 1 && ordem[2] == 2 && ordem[3] == 3 ? "ok" : "ERRO") ;
+
+   sem_destroy (&s_recurso) ;
+   mutex_destroy (&m_recurso) ;
+}
+
+void rodada (char *nome, int policy)
+{
+   int i, ficha = 1 ;
+
+   atendidas = 0 ;
+   switch (modo)
+   {
+   case 0: sem_create (&s_recurso, 0) ; sem_setpolicy (&s_recurso, policy) ; break ;
+   case 1: mutex_create (&m_recurso) ; mutex_setpolicy (&m_recurso, policy) ;
+           mutex_lock (&m_recurso) ; break ;
+   case 2: mqueue_create (&q_recurso, 1, sizeof (int)) ; mqueue_setpolicy (&q_recurso, policy) ; break ;
+   }
+
+   // as de fundo bloqueiam primeiro, Alta por último
+   for (i = 0; i < FUNDO; i++)
+   {
+      task_create (&Fundo[i], cliente, NULL) ;
+      task_setprio (&Fundo[i], 20) ;
+   }
+   task_sleep (10) ;
+   task_create (&Alta, cliente, &Alta) ;
+   task_setprio (&Alta, -20) ;
+   task_sleep (10) ;
+
+   // libera o recurso para a primeira da fila
+   switch (modo)
+   {
+   case 0: sem_up (&s_recurso) ; break ;
+   case 1: mutex_unlock (&m_recurso) ; break ;
+   case 2: mqueue_send (&q_recurso, &ficha) ; break ;
+   }
+
+   task_join (&Alta) ;
+   for (i = 0; i < FUNDO; i++)
+      task_join (&Fundo[i]) ;
+
+   printf ("%-8s %s: Alta atendida na posicao %2d de %d, apos %4u ms\n", nome,
+           policy == WAIT_PRIO ? "WAIT_PRIO" : "WAIT_FIFO", posicao_alta,
+           FUNDO + 1, espera_alta) ;
+
+   switch (modo)
+   {
+   case 0: sem_destroy (&s_recurso) ; break ;
+   case 1: mutex_destroy (&m_recurso) ; break ;
+   case 2: mqueue_destroy (&q_recurso) ; break ;
+   }
+}
+
+int main (int argc, char *argv[])
+{
+   ppos_init () ;
+
+   modo = 0 ;
+   rodada ("semaforo", WAIT_FIFO) ;
+   rodada ("semaforo", WAIT_PRIO) ;
+   modo = 1 ;
+   rodada ("mutex", WAIT_FIFO) ;
+   rodada ("mutex", WAIT_PRIO) ;
+   modo = 2 ;
+   rodada ("mqueue", WAIT_FIFO) ;
+   rodada ("mqueue", WAIT_PRIO) ;
+   heranca_na_fila () ;
+
+   // só WAIT_FIFO e WAIT_PRIO são aceitas
+   mutex_create (&m_recurso) ;
+   printf ("mutex_setpolicy invalida: %d\n", mutex_setpolicy (&m_recurso, 7)) ;
+   mutex_destroy (&m_recurso) ;
+
+   task_exit (0) ;
+}
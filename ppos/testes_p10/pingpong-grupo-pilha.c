@@ -0,0 +1,126 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Pilha compartilhada: TAREFAS tarefas de um mesmo grupo descem PROFUNDIDADE
+// níveis de recursão, cedendo o processador pelo caminho e bloqueando num
+// semáforo no fundo, enquanto as outras (e a preempção) ocupam a pilha do
+// grupo. Na volta cada nível confere as suas variáveis locais, que precisam ter
+// sobrevivido a todas as trocas. Por fim o grupo é destruído e a memória dele
+// (a pilha compartilhada e as cópias das tarefas) tem de ser liberada.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "ppos.h"
+
+#define TAREFAS 50
+#define PROFUNDIDADE 300
+#define QUADRO 64                 // inteiros locais por nível
+
+task_t Tarefa[TAREFAS] ;
+stack_group_t grupo ;
+semaphore_t s_fundo ;
+int no_fundo, corrompidos, niveis ;
+
+// preenche os locais do nível, desce e confere os locais na volta
+void desce (long id, int nivel)
+{
+   int local[QUADRO], i ;
+
+   for (i = 0; i < QUADRO; i++)
+      local[i] = id * 100000 + nivel * 100 + i ;
+
+   if (nivel % 37 == 0)
+      task_yield () ;
+
+   if (nivel == PROFUNDIDADE)
+   {
+      no_fundo++ ;
+      sem_down (&s_fundo) ;
+   }
+   else
+      desce (id, nivel + 1) ;
+
+   for (i = 0; i < QUADRO; i++)
+      if (local[i] != id * 100000 + nivel * 100 + i)
+      {
+         corrompidos++ ;
+         break ;
+      }
+   niveis++ ;
+}
+
+void tarefa (void *arg)
+{
+   desce ((long) arg, 0) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   task_attr_t attr = {0} ;
+   unsigned char residente ;
+   size_t guardado = 0 ;
+   void *pilha ;
+   long i ;
+   int erros = 0 ;
+
+   ppos_init () ;
+
+   if (stack_group_create (&grupo, 0) < 0)
+   {
+      printf ("pilha compartilhada indisponivel nesta troca de contexto\n") ;
+      task_exit (0) ;
+   }
+   pilha = grupo.stack ;
+   sem_create (&s_fundo, 0) ;
+
+   attr.stack_group = &grupo ;
+   for (i = 0; i < TAREFAS; i++)
+      task_create_attr (&Tarefa[i], tarefa, (void *) i, &attr) ;
+
+   // todas no fundo da recursão, com a pilha guardada fora do grupo
+   while (no_fundo < TAREFAS)
+      task_yield () ;
+   printf ("%d tarefas no fundo de %d niveis\n", no_fundo, PROFUNDIDADE) ;
+
+   // a dona da pilha do grupo ainda não foi guardada; as demais, inteiras
+   for (i = 0; i < TAREFAS; i++)
+      guardado += Tarefa[i].stack_saved ;
+   printf ("pilhas guardadas fora do grupo: %s\n",
+           guardado >= (TAREFAS - 1) * PROFUNDIDADE * QUADRO * sizeof (int) ? "ok" : "ERRO") ;
+   if (guardado < (TAREFAS - 1) * PROFUNDIDADE * QUADRO * sizeof (int))
+      erros++ ;
+   if (stack_group_destroy (&grupo) != -1)
+      erros++ ;
+   printf ("stack_group_destroy com tarefas vivas: %s\n", grupo.stack ? "recusado" : "ERRO") ;
+
+   for (i = 0; i < TAREFAS; i++)
+      sem_up (&s_fundo) ;
+   for (i = 0; i < TAREFAS; i++)
+      task_join (&Tarefa[i]) ;
+   printf ("%d niveis conferidos (%d esperados), %d corrompidos\n", niveis,
+           TAREFAS * (PROFUNDIDADE + 1), corrompidos) ;
+   if (niveis != TAREFAS * (PROFUNDIDADE + 1) || corrompidos)
+      erros++ ;
+
+   // as cópias das pilhas foram liberadas com as tarefas, e a pilha do grupo
+   // deixa de estar mapeada (mincore falha numa página não mapeada)
+   guardado = 0 ;
+   for (i = 0; i < TAREFAS; i++)
+      if (Tarefa[i].stack_save || Tarefa[i].stack_save_size)
+         guardado++ ;
+   printf ("copias de pilha apos as tarefas: %s\n", guardado ? "ERRO" : "liberadas") ;
+   if (guardado)
+      erros++ ;
+   if (stack_group_destroy (&grupo) != 0)
+      erros++ ;
+   printf ("pilha do grupo apos stack_group_destroy: %s\n",
+           mincore (pilha, sysconf (_SC_PAGESIZE), &residente) < 0 ? "desmapeada" : "ERRO") ;
+   if (mincore (pilha, sysconf (_SC_PAGESIZE), &residente) == 0)
+      erros++ ;
+
+   printf ("%s: %d erros\n", erros ? "ERRO" : "ok", erros) ;
+   sem_destroy (&s_fundo) ;
+   task_exit (0) ;
+}
@@ -0,0 +1,85 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Tarefas longas e uma interativa: LONGAS tarefas fazem uma quantidade fixa de
+// cálculo enquanto Interativa dorme 5 ms em laço, como se esperasse o usuário.
+// Sem SCHED_MLFQ, a interativa acorda e espera as longas gastarem seus quanta;
+// compilado com -DSCHED_MLFQ=1, as longas descem de nível e a interativa, que
+// nunca gasta o quantum, toma o processador assim que acorda. Mostra o atraso
+// médio e máximo da interativa e quando cada longa terminou (nenhuma deve
+// passar fome).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define LONGAS 4
+#define TRABALHO 12000
+#define SONO 5                    // ms
+#define SONECAS 200
+
+task_t Longa[LONGAS], Interativa ;
+unsigned int inicio, termino[LONGAS] ;
+unsigned int atraso_total, atraso_maximo ;
+
+// simula um processamento pesado
+int hardwork (int n)
+{
+   int i, j, soma ;
+
+   soma = 0 ;
+   for (i=0; i<n; i++)
+      for (j=0; j<n; j++)
+         soma += j ;
+   return (soma) ;
+}
+
+void longa (void *arg)
+{
+   long i = (long) arg ;
+
+   hardwork (TRABALHO) ;
+   termino[i] = systime () - inicio ;
+   task_exit (0) ;
+}
+
+void interativa (void *arg)
+{
+   unsigned int antes, atraso ;
+   int i ;
+
+   for (i = 0; i < SONECAS; i++)
+   {
+      antes = systime () ;
+      task_sleep (SONO) ;
+      atraso = systime () - antes - SONO ;
+      atraso_total += atraso ;
+      if (atraso > atraso_maximo)
+         atraso_maximo = atraso ;
+      hardwork (100) ;            // trata o evento
+   }
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   long i ;
+
+   ppos_init () ;
+
+   inicio = systime () ;
+   for (i = 0; i < LONGAS; i++)
+      task_create (&Longa[i], longa, (void *) i) ;
+   task_create (&Interativa, interativa, NULL) ;
+
+   task_join (&Interativa) ;
+   printf ("interativa: %d sonecas de %d ms em %u ms, atraso medio %u.%02u ms, maximo %u ms\n",
+           SONECAS, SONO, systime () - inicio, atraso_total / SONECAS,
+           atraso_total * 100 / SONECAS % 100, atraso_maximo) ;
+
+   for (i = 0; i < LONGAS; i++)
+      task_join (&Longa[i]) ;
+   for (i = 0; i < LONGAS; i++)
+      printf ("longa %ld terminou apos %u ms\n", i, termino[i]) ;
+
+   task_exit (0) ;
+}
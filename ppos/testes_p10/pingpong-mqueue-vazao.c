@@ -0,0 +1,195 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Vazão da fila de mensagens em três modos: mqueue_send/mqueue_recv de
+// inteiros, envio e recepção em lotes, e mensagens grandes escritas e lidas no
+// lugar (mqueue_reserve/commit e mqueue_peek/release). Em cada modo, EMISSORES
+// tarefas enviam e RECEPTORES tarefas recebem; a soma recebida deve ser igual à
+// enviada. Ao final, confere que mqueue_destroy libera uma tarefa bloqueada.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+
+#define EMISSORES 2
+#define RECEPTORES 2
+#define MENSAGENS 200000          // por emissor
+#define GRANDES 20000             // mensagens grandes, por emissor
+#define TAMANHO 4096              // bytes de uma mensagem grande
+#define CAPACIDADE 64
+#define LOTE 16
+
+task_t Emissor[EMISSORES], Receptor[RECEPTORES], Presa ;
+mqueue_t fila, fila_grande, fila_destruida ;
+long long soma_enviada, soma_recebida ;
+int modo ;
+
+typedef struct
+{
+   int valor ;
+   char dados[TAMANHO - sizeof (int)] ;
+} grande_t ;
+
+void emissor (void *arg)
+{
+   int lote[LOTE], i, j, n ;
+   grande_t *m ;
+
+   switch (modo)
+   {
+   case 0:
+      for (i = 1; i <= MENSAGENS; i++)
+      {
+         mqueue_send (&fila, &i) ;
+         soma_enviada += i ;
+      }
+      break ;
+
+   case 1:
+      for (i = 1; i <= MENSAGENS; i += n)
+      {
+         for (j = 0; j < LOTE; j++)
+            lote[j] = i + j ;
+         n = MENSAGENS - i + 1 < LOTE ? MENSAGENS - i + 1 : LOTE ;
+         n = mqueue_send_batch (&fila, lote, n) ;
+         for (j = 0; j < n; j++)
+            soma_enviada += lote[j] ;
+      }
+      break ;
+
+   case 2:
+      for (i = 1; i <= GRANDES; i++)
+      {
+         m = mqueue_reserve (&fila_grande) ;
+         m->valor = i ;
+         memset (m->dados, i & 0xff, sizeof (m->dados)) ;
+         mqueue_commit (&fila_grande, m) ;
+         soma_enviada += i ;
+      }
+      break ;
+   }
+
+   task_exit (0) ;
+}
+
+void receptor (void *arg)
+{
+   int lote[LOTE], valor, j, n ;
+   grande_t *m ;
+
+   // o valor 0 encerra o receptor
+   while (1)
+   {
+      switch (modo)
+      {
+      case 0:
+         mqueue_recv (&fila, &valor) ;
+         if (!valor)
+            task_exit (0) ;
+         soma_recebida += valor ;
+         break ;
+
+      case 1:
+         n = mqueue_recv_batch (&fila, lote, LOTE) ;
+         for (j = 0; j < n; j++)
+         {
+            if (!lote[j])
+               task_exit (0) ;
+            soma_recebida += lote[j] ;
+         }
+         break ;
+
+      case 2:
+         m = mqueue_peek (&fila_grande) ;
+         valor = m->valor ;
+         if (valor && (m->dados[0] != (char) (valor & 0xff) || m->dados[sizeof (m->dados) - 1] != (char) (valor & 0xff)))
+            printf ("ERRO: mensagem %d corrompida\n", valor) ;
+         mqueue_release (&fila_grande, m) ;
+         if (!valor)
+            task_exit (0) ;
+         soma_recebida += valor ;
+         break ;
+      }
+   }
+}
+
+void presa (void *arg)
+{
+   int valor ;
+
+   task_exit (mqueue_recv (&fila_destruida, &valor)) ;
+}
+
+void rodada (char *nome, int mensagens)
+{
+   unsigned int inicio, fim ;
+   grande_t *m ;
+   int i, zero = 0 ;
+
+   soma_enviada = soma_recebida = 0 ;
+   inicio = systime () ;
+
+   for (i = 0; i < EMISSORES; i++)
+      task_create (&Emissor[i], emissor, NULL) ;
+   for (i = 0; i < RECEPTORES; i++)
+      task_create (&Receptor[i], receptor, NULL) ;
+   for (i = 0; i < EMISSORES; i++)
+      task_join (&Emissor[i]) ;
+
+   // um valor 0 para cada receptor encerrar; um receptor em lote encerra ao
+   // ver o primeiro, então o próximo só é enviado depois que este foi lido
+   for (i = 0; i < RECEPTORES; i++)
+   {
+      if (modo == 2)
+      {
+         m = mqueue_reserve (&fila_grande) ;
+         m->valor = 0 ;
+         mqueue_commit (&fila_grande, m) ;
+         while (mqueue_msgs (&fila_grande) > 0)
+            task_yield () ;
+      }
+      else
+      {
+         mqueue_send (&fila, &zero) ;
+         while (mqueue_msgs (&fila) > 0)
+            task_yield () ;
+      }
+   }
+   for (i = 0; i < RECEPTORES; i++)
+      task_join (&Receptor[i]) ;
+   fim = systime () ;
+
+   printf ("%-18s %7d mensagens em %4u ms, soma %s\n", nome,
+           EMISSORES * mensagens, fim - inicio,
+           soma_enviada == soma_recebida ? "ok" : "ERRO") ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i ;
+
+   ppos_init () ;
+
+   mqueue_create (&fila, CAPACIDADE, sizeof (int)) ;
+   mqueue_create (&fila_grande, CAPACIDADE, sizeof (grande_t)) ;
+   mqueue_create (&fila_destruida, 4, sizeof (int)) ;
+
+   modo = 0 ;
+   rodada ("send/recv", MENSAGENS) ;
+   modo = 1 ;
+   rodada ("lotes", MENSAGENS) ;
+   modo = 2 ;
+   rodada ("reserve/peek 4KB", GRANDES) ;
+
+   task_create (&Presa, presa, NULL) ;
+   task_sleep (10) ;
+   mqueue_destroy (&fila_destruida) ;
+   printf ("fila destruida: mqueue_recv retornou %d\n", task_join (&Presa)) ;
+
+   i = mqueue_msgs (&fila) ;
+   printf ("mensagens restantes: %d\n", i) ;
+
+   mqueue_destroy (&fila) ;
+   mqueue_destroy (&fila_grande) ;
+   task_exit (0) ;
+}
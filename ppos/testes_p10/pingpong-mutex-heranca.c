@@ -0,0 +1,146 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Inversão de prioridade: Baixa (prioridade 20) pega o mutex; depois MEDIAS
+// tarefas de prioridade 0 passam a disputar o processador e Alta (prioridade
+// -20) pede o mutex. Com a herança de prioridade, Baixa passa a executar com a
+// prioridade de Alta até liberar o mutex, e a espera de Alta não depende das
+// tarefas médias. Destruir um mutex pelo qual Alta espera desfaz a herança de
+// Baixa (que volta ao balde da sua prioridade). Confere também a exclusão mútua
+// com várias tarefas.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define MEDIAS 4
+#define TRABALHO 4000
+#define CONTADORES 5
+#define INCREMENTOS 100000
+
+task_t Baixa, Alta, Media[MEDIAS], Contador[CONTADORES] ;
+mutex_t m_recurso, m_soma, m_destruido ;
+long long soma ;
+volatile int fim_medias, fim_baixa ;
+
+// simula um processamento pesado
+int hardwork (int n)
+{
+   int i, j, soma ;
+
+   soma = 0 ;
+   for (i=0; i<n; i++)
+      for (j=0; j<n; j++)
+         soma += j ;
+   return (soma) ;
+}
+
+void baixa (void *arg)
+{
+   mutex_lock (&m_recurso) ;
+   printf ("Baixa: pegou o mutex em %u ms\n", systime ()) ;
+   hardwork (TRABALHO) ;
+   printf ("Baixa: liberou o mutex em %u ms\n", systime ()) ;
+   mutex_unlock (&m_recurso) ;
+   task_exit (0) ;
+}
+
+void alta (void *arg)
+{
+   unsigned int inicio ;
+
+   inicio = systime () ;
+   mutex_lock (&m_recurso) ;
+   printf ("Alta: esperou o mutex por %u ms\n", systime () - inicio) ;
+   mutex_unlock (&m_recurso) ;
+   task_exit (0) ;
+}
+
+// pega o mutex e segue trabalhando até main mandar parar
+void baixa_ocupada (void *arg)
+{
+   mutex_lock (&m_destruido) ;
+   while (!fim_baixa)
+      hardwork (100) ;
+   task_exit (0) ;
+}
+
+void alta_destruida (void *arg)
+{
+   task_exit (mutex_lock (&m_destruido)) ;
+}
+
+void media (void *arg)
+{
+   while (!fim_medias)
+      hardwork (100) ;
+   task_exit (0) ;
+}
+
+void contador (void *arg)
+{
+   int i ;
+
+   for (i = 0; i < INCREMENTOS; i++)
+   {
+      mutex_lock (&m_soma) ;
+      soma++ ;
+      mutex_unlock (&m_soma) ;
+   }
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i ;
+
+   ppos_init () ;
+   task_setprio (NULL, -20) ;
+
+   mutex_create (&m_recurso) ;
+   mutex_create (&m_soma) ;
+
+   // Baixa pega o mutex enquanto main dorme
+   task_create (&Baixa, baixa, NULL) ;
+   task_setprio (&Baixa, 20) ;
+   task_sleep (5) ;
+
+   task_create (&Alta, alta, NULL) ;
+   task_setprio (&Alta, -20) ;
+   for (i = 0; i < MEDIAS; i++)
+      task_create (&Media[i], media, NULL) ;
+
+   task_join (&Alta) ;
+   task_join (&Baixa) ;
+   fim_medias = 1 ;
+   for (i = 0; i < MEDIAS; i++)
+      task_join (&Media[i]) ;
+
+   for (i = 0; i < CONTADORES; i++)
+      task_create (&Contador[i], contador, NULL) ;
+   for (i = 0; i < CONTADORES; i++)
+      task_join (&Contador[i]) ;
+   printf ("soma: %lld (esperado %d): %s\n", soma, CONTADORES * INCREMENTOS,
+           soma == CONTADORES * INCREMENTOS ? "ok" : "ERRO") ;
+
+   // Alta espera um mutex que é destruído enquanto Baixa o detém
+   mutex_create (&m_destruido) ;
+   task_create (&Baixa, baixa_ocupada, NULL) ;
+   task_setprio (&Baixa, 20) ;
+   task_sleep (5) ;
+   task_create (&Alta, alta_destruida, NULL) ;
+   task_setprio (&Alta, -20) ;
+   task_sleep (5) ;
+   printf ("Baixa herdou a prioridade %d de Alta: %s\n", Baixa.prio_inherited,
+           Baixa.prio_inherited == -20 && Baixa.prio_dinamic == -20 ? "ok" : "ERRO") ;
+   mutex_destroy (&m_destruido) ;
+   printf ("mutex destruido: Baixa volta a prioridade %d: %s\n", Baixa.prio_dinamic,
+           Baixa.prio_inherited == PRIO_MAX && Baixa.prio_dinamic == 20 ? "ok" : "ERRO") ;
+   printf ("Alta recebeu %d do mutex_lock\n", task_join (&Alta)) ;
+   fim_baixa = 1 ;
+   task_join (&Baixa) ;
+
+   mutex_destroy (&m_recurso) ;
+   mutex_destroy (&m_soma) ;
+
+   task_exit (0) ;
+}
@@ -0,0 +1,109 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Dispatcher ocioso: com todas as tarefas adormecidas por DURACAO ms, o processo
+// deve ficar suspenso (tempo de processador perto de zero, medido com
+// getrusage). Depois TAREFAS tarefas dormem e esperam com prazo durações curtas
+// e desencontradas, de modo que os despertares chegam com o processo suspenso
+// em sigsuspend ou prestes a entrar nele; nenhum pode se perder, o que
+// apareceria como um atraso de LIMITE ms ou mais (ou o teste travado).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "ppos.h"
+
+#define DURACAO 1000              // ms
+#define TAREFAS 20
+#define RODADAS 100
+#define LIMITE 100                // ms
+#define USO_MAXIMO 10             // % do tempo de relógio
+
+task_t Dorminhoca, Tarefa[TAREFAS] ;
+semaphore_t s_nunca ;
+int acordadas, perdidas ;
+long long atraso_maximo ;
+
+// relógio do teste, em micro-segundos
+long long relogio_us ()
+{
+   struct timespec t ;
+
+   clock_gettime (CLOCK_MONOTONIC, &t) ;
+   return t.tv_sec * 1000000LL + t.tv_nsec / 1000 ;
+}
+
+// tempo de processador do processo, em micro-segundos
+long long processador_us ()
+{
+   struct rusage uso ;
+
+   getrusage (RUSAGE_SELF, &uso) ;
+   return (uso.ru_utime.tv_sec + uso.ru_stime.tv_sec) * 1000000LL
+          + uso.ru_utime.tv_usec + uso.ru_stime.tv_usec ;
+}
+
+void dorminhoca (void *arg)
+{
+   task_sleep (DURACAO / 2) ;
+   task_sleep (DURACAO / 2) ;
+   task_exit (0) ;
+}
+
+// dorme e espera com prazo, alternando, por 1 a 5 ms
+void tarefa (void *arg)
+{
+   long i = (long) arg ;
+   long long antes, atraso ;
+   int r, t ;
+
+   for (r = 0; r < RODADAS; r++)
+   {
+      t = 1 + (i + r) % 5 ;
+      antes = relogio_us () ;
+      if (r % 2)
+         task_sleep (t) ;
+      else
+         sem_down_timeout (&s_nunca, t) ;
+      atraso = relogio_us () - antes - t * 1000 ;
+      if (atraso > atraso_maximo)
+         atraso_maximo = atraso ;
+      if (atraso >= LIMITE * 1000)
+         perdidas++ ;
+      acordadas++ ;
+   }
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   long long relogio, processador, uso ;
+   long i ;
+
+   ppos_init () ;
+
+   // todas as tarefas adormecidas: main espera a dorminhoca
+   task_create (&Dorminhoca, dorminhoca, NULL) ;
+   relogio = relogio_us () ;
+   processador = processador_us () ;
+   task_join (&Dorminhoca) ;
+   processador = processador_us () - processador ;
+   relogio = relogio_us () - relogio ;
+   uso = processador * 100 / relogio ;
+   printf ("ociosa por %lld ms: %lld us de processador (%lld%%): %s\n",
+           relogio / 1000, processador, uso, uso < USO_MAXIMO ? "ok" : "ERRO") ;
+
+   // despertares chegando com o processo suspenso
+   sem_create (&s_nunca, 0) ;
+   for (i = 0; i < TAREFAS; i++)
+      task_create (&Tarefa[i], tarefa, (void *) i) ;
+   for (i = 0; i < TAREFAS; i++)
+      task_join (&Tarefa[i]) ;
+   printf ("%d despertares (%d esperados), %d com atraso de %d ms ou mais: %s\n",
+           acordadas, TAREFAS * RODADAS, perdidas, LIMITE,
+           acordadas == TAREFAS * RODADAS && !perdidas ? "ok" : "ERRO") ;
+   printf ("atraso maximo %lld us\n", atraso_maximo) ;
+
+   sem_destroy (&s_nunca) ;
+   task_exit (0) ;
+}
@@ -0,0 +1,238 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Alocador de pilhas: tarefas com vários tamanhos de pilha usam a pilha toda e
+// conferem a classe (potência de 2, no mínimo 16 KB); mais de STACK_POOL_MAX
+// pilhas de uma classe são liberadas juntas (só POOL ficam guardadas, as demais
+// são desmapeadas) e reaproveitadas; um estouro de pilha cai na página de
+// guarda (SIGSEGV, tratado numa pilha alternativa); com o limite de mapeamentos
+// do processo esgotado a pilha vem do malloc; por fim, ESCALA tarefas curtas
+// são criadas e encerradas, LOTE por vez.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <alloca.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "ppos.h"
+
+#define POOL 64                   // STACK_POOL_MAX do núcleo
+#define MUITAS 100
+#define ESCALA 100000
+#define LOTE 16
+
+task_t Tarefa[MUITAS] ;
+void *Pilha[MUITAS] ;
+semaphore_t s_espera ;
+sigjmp_buf volta ;
+char *guarda ;
+volatile int estouros, fora_da_guarda ;
+int erros, executadas ;
+long pagina ;
+
+void confere (char *nome, int ok)
+{
+   printf ("%-52s %s\n", nome, ok ? "ok" : "ERRO") ;
+   if (!ok)
+      erros++ ;
+}
+
+// usa quase toda a pilha (deixa 8 KB para os tratadores de sinal) e confere
+// que a área usada está nela
+int usa_pilha (task_t *eu)
+{
+   char *area ;
+
+   area = alloca (eu->stack_size - 8 * 1024) ;
+   memset (area, 1, eu->stack_size - 8 * 1024) ;
+   if (area < (char *) eu->stack || area >= (char *) eu->stack + eu->stack_size)
+      erros++ ;
+   return area[0] ;
+}
+
+void tamanho (void *arg)
+{
+   task_exit (usa_pilha (arg)) ;
+}
+
+// espera main criar todas as irmãs, para que as pilhas estejam todas em uso
+void irma (void *arg)
+{
+   sem_down (&s_espera) ;
+   task_exit (0) ;
+}
+
+// SIGSEGV: confere se o endereço é da página de guarda e volta para a tarefa
+void falha (int signum, siginfo_t *info, void *contexto)
+{
+   if ((char *) info->si_addr >= guarda && (char *) info->si_addr < guarda + pagina)
+      estouros++ ;
+   else
+      fora_da_guarda++ ;
+   siglongjmp (volta, 1) ;
+}
+
+int recursao (int n)
+{
+   char quadro[1024] ;
+
+   // o limite nunca é alcançado: a pilha acaba antes
+   if (n > 1000000)
+      return 0 ;
+   memset (quadro, n, sizeof (quadro)) ;
+   return recursao (n + 1) + quadro[n % sizeof (quadro)] ;
+}
+
+void estoura (void *arg)
+{
+   task_t *eu = arg ;
+
+   guarda = (char *) eu->stack - pagina ;
+   if (!sigsetjmp (volta, 1))
+      recursao (0) ;
+   task_exit (0) ;
+}
+
+void curta (void *arg)
+{
+   executadas++ ;
+   task_exit (0) ;
+}
+
+// ocupa os mapeamentos livres do processo: uma área de páginas com proteções
+// alternadas vira um mapeamento por página, até o núcleo recusar
+char *esgota_mapeamentos (size_t *tamanho_area)
+{
+   size_t paginas = 70000, i ;
+   char *area ;
+
+   area = mmap (NULL, paginas * pagina, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) ;
+   if (area == MAP_FAILED)
+      return NULL ;
+   for (i = 1; i < paginas; i += 2)
+      if (mprotect (area + i * pagina, pagina, PROT_NONE) < 0)
+         break ;
+   *tamanho_area = paginas * pagina ;
+   return area ;
+}
+
+int main (int argc, char *argv[])
+{
+   size_t tamanhos[] = {0, 1, 16 * 1024, 20 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024} ;
+   size_t esperados[] = {64 * 1024, 16 * 1024, 16 * 1024, 32 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024} ;
+   task_attr_t attr = {0} ;
+   struct sigaction acao = {0} ;
+   stack_t alternativa ;
+   char nome[64], *area ;
+   size_t tamanho_area ;
+   int i, j, mapeadas, reaproveitadas, ok ;
+   unsigned int inicio ;
+
+   ppos_init () ;
+   pagina = sysconf (_SC_PAGESIZE) ;
+
+   // classes de tamanho
+   for (i = 0; i < sizeof (tamanhos) / sizeof (tamanhos[0]); i++)
+   {
+      attr.stack_size = tamanhos[i] ;
+      j = erros ;
+      task_create_attr (&Tarefa[0], tamanho, &Tarefa[0], &attr) ;
+      ok = Tarefa[0].stack_size == esperados[i] && Tarefa[0].stack_mapped ;
+      ok = ok && task_join (&Tarefa[0]) == 1 && erros == j ;
+      sprintf (nome, "pilha pedida de %zu bytes: %zu bytes", tamanhos[i], esperados[i]) ;
+      confere (nome, ok) ;
+   }
+
+   // pilhas de 128 KB, que nenhuma outra tarefa usa: todas ocupadas ao mesmo
+   // tempo e liberadas juntas
+   attr.stack_size = 128 * 1024 ;
+   sem_create (&s_espera, 0) ;
+   for (i = 0; i < MUITAS; i++)
+   {
+      task_create_attr (&Tarefa[i], irma, NULL, &attr) ;
+      Pilha[i] = Tarefa[i].stack ;
+   }
+   for (i = 0; i < MUITAS; i++)
+      sem_up (&s_espera) ;
+   for (i = 0; i < MUITAS; i++)
+      task_join (&Tarefa[i]) ;
+
+   // msync falha (ENOMEM) numa página que não está mapeada
+   mapeadas = 0 ;
+   for (i = 0; i < MUITAS; i++)
+      if (msync (Pilha[i], pagina, MS_ASYNC) == 0)
+         mapeadas++ ;
+   sprintf (nome, "%d pilhas liberadas, %d guardadas (%d esperadas)", MUITAS, mapeadas, POOL) ;
+   confere (nome, mapeadas == POOL) ;
+
+   // as próximas POOL pilhas da classe vêm todas das guardadas
+   for (i = 0; i < POOL; i++)
+      task_create_attr (&Tarefa[MUITAS - 1 - i], irma, NULL, &attr) ;
+   reaproveitadas = 0 ;
+   for (i = 0; i < POOL; i++)
+      for (j = 0; j < MUITAS; j++)
+         if (Tarefa[MUITAS - 1 - i].stack == Pilha[j] && msync (Pilha[j], pagina, MS_ASYNC) == 0)
+         {
+            reaproveitadas++ ;
+            break ;
+         }
+   for (i = 0; i < POOL; i++)
+      sem_up (&s_espera) ;
+   for (i = 0; i < POOL; i++)
+      task_join (&Tarefa[MUITAS - 1 - i]) ;
+   sprintf (nome, "%d pilhas reaproveitadas (%d esperadas)", reaproveitadas, POOL) ;
+   confere (nome, reaproveitadas == POOL) ;
+
+   // estouro de pilha: o tratador roda numa pilha alternativa
+   alternativa.ss_sp = malloc (SIGSTKSZ + 64 * 1024) ;
+   alternativa.ss_size = SIGSTKSZ + 64 * 1024 ;
+   alternativa.ss_flags = 0 ;
+   sigaltstack (&alternativa, NULL) ;
+   acao.sa_sigaction = falha ;
+   acao.sa_flags = SA_SIGINFO | SA_ONSTACK ;
+   sigaction (SIGSEGV, &acao, NULL) ;
+   attr.stack_size = 16 * 1024 ;
+   task_create_attr (&Tarefa[0], estoura, &Tarefa[0], &attr) ;
+   task_join (&Tarefa[0]) ;
+   sprintf (nome, "estouro de pilha na pagina de guarda: %d", estouros) ;
+   confere (nome, estouros == 1 && !fora_da_guarda) ;
+   acao.sa_handler = SIG_DFL ;
+   acao.sa_flags = 0 ;
+   sigaction (SIGSEGV, &acao, NULL) ;
+
+   // sem mapeamentos livres, a pilha vem do malloc, sem guarda; com eles de
+   // volta, do mmap. A irmã ocupa a pilha de 32 KB guardada (do pedido de 20 KB)
+   attr.stack_size = 32 * 1024 ;
+   task_create_attr (&Tarefa[1], irma, NULL, &attr) ;
+   area = esgota_mapeamentos (&tamanho_area) ;
+   task_create_attr (&Tarefa[0], tamanho, &Tarefa[0], &attr) ;
+   ok = area && !Tarefa[0].stack_mapped && Tarefa[0].stack_size == 32 * 1024 ;
+   j = erros ;
+   ok = task_join (&Tarefa[0]) == 1 && erros == j && ok ;
+   if (area)
+      munmap (area, tamanho_area) ;
+   sem_up (&s_espera) ;
+   task_join (&Tarefa[1]) ;
+   confere ("sem mapeamentos livres: pilha do malloc", ok) ;
+   task_create_attr (&Tarefa[0], tamanho, &Tarefa[0], &attr) ;
+   ok = Tarefa[0].stack_mapped ;
+   confere ("com mapeamentos livres: pilha do mmap", task_join (&Tarefa[0]) == 1 && ok) ;
+
+   // escala: as pilhas giram pela lista de livres
+   inicio = systime () ;
+   for (i = 0; i < ESCALA; i += LOTE)
+   {
+      for (j = 0; j < LOTE; j++)
+         task_create (&Tarefa[j], curta, NULL) ;
+      for (j = 0; j < LOTE; j++)
+         task_join (&Tarefa[j]) ;
+   }
+   printf ("%d tarefas criadas e encerradas em %u ms\n", ESCALA, systime () - inicio) ;
+   confere ("todas executaram", executadas == ESCALA) ;
+
+   printf ("%s: %d erros\n", erros ? "ERRO" : "ok", erros) ;
+   sem_destroy (&s_espera) ;
+   task_exit (0) ;
+}
@@ -0,0 +1,145 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Esperas com prazo: cada primitiva bloqueante é testada com o prazo vencendo
+// (-2) e com a espera atendida antes do prazo (0); task_join_timeout informa o
+// código de encerramento à parte, mesmo quando ele é -2; por fim, ESPERAS tarefas
+// esperam com prazo no mesmo semáforo, todas vencem, e um sem_destroy libera
+// uma tarefa cujo prazo ainda não venceu.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define ESPERAS 1000
+
+task_t Ajudante, Longa, MenosDois, Parceira[2], Destruida, Espera[ESPERAS] ;
+semaphore_t s_vazio, s_muitos ;
+mutex_t m_ocupado ;
+mqueue_t fila ;
+barrier_t b_tres ;
+int vencidas ;
+
+// marca o tempo e o resultado de uma espera
+void confere (char *nome, int ret, int esperado, unsigned int inicio)
+{
+   printf ("%-26s retornou %2d apos %3u ms: %s\n", nome, ret, systime () - inicio,
+           ret == esperado ? "ok" : "ERRO") ;
+}
+
+void ajudante (void *arg)
+{
+   int valor = 42 ;
+
+   task_sleep (20) ;
+   sem_up (&s_vazio) ;
+   task_sleep (20) ;
+   mqueue_send (&fila, &valor) ;
+   task_exit (0) ;
+}
+
+void longa (void *arg)
+{
+   mutex_lock (&m_ocupado) ;
+   task_sleep (200) ;
+   mutex_unlock (&m_ocupado) ;
+   task_exit (7) ;
+}
+
+void menos_dois (void *arg)
+{
+   task_sleep (20) ;
+   task_exit (-2) ;
+}
+
+void espera (void *arg)
+{
+   if (sem_down_timeout (&s_muitos, 30) == -2)
+      vencidas++ ;
+   task_exit (0) ;
+}
+
+void parceira (void *arg)
+{
+   task_exit (barrier_join (&b_tres)) ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned int inicio ;
+   int i, valor, codigo ;
+
+   ppos_init () ;
+
+   sem_create (&s_vazio, 0) ;
+   sem_create (&s_muitos, 0) ;
+   mutex_create (&m_ocupado) ;
+   mqueue_create (&fila, 4, sizeof (int)) ;
+   barrier_create (&b_tres, 3) ;
+
+   task_create (&Longa, longa, NULL) ;
+   task_sleep (5) ;
+
+   inicio = systime () ;
+   confere ("sem_down_timeout", sem_down_timeout (&s_vazio, 30), -2, inicio) ;
+   inicio = systime () ;
+   confere ("mutex_lock_timeout", mutex_lock_timeout (&m_ocupado, 30), -2, inicio) ;
+   inicio = systime () ;
+   confere ("mqueue_recv_timeout", mqueue_recv_timeout (&fila, &valor, 30), -2, inicio) ;
+   inicio = systime () ;
+   confere ("task_join_timeout", task_join_timeout (&Longa, 30, &codigo), -2, inicio) ;
+   inicio = systime () ;
+   confere ("barrier_join_timeout", barrier_join_timeout (&b_tres, 30), -2, inicio) ;
+
+   // agora as esperas são atendidas antes do prazo
+   task_create (&Ajudante, ajudante, NULL) ;
+   inicio = systime () ;
+   confere ("sem_down_timeout (up)", sem_down_timeout (&s_vazio, 1000), 0, inicio) ;
+   inicio = systime () ;
+   confere ("mqueue_recv_timeout (send)", mqueue_recv_timeout (&fila, &valor, 1000), 0, inicio) ;
+   inicio = systime () ;
+   codigo = 0 ;
+   confere ("task_join_timeout (fim)", task_join_timeout (&Longa, 1000, &codigo), 0, inicio) ;
+   confere ("  codigo de encerramento", codigo, 7, inicio) ;
+   task_create (&MenosDois, menos_dois, NULL) ;
+   inicio = systime () ;
+   confere ("task_join_timeout (-2)", task_join_timeout (&MenosDois, 1000, &codigo), 0, inicio) ;
+   confere ("  codigo de encerramento", codigo, -2, inicio) ;
+   confere ("task_join_timeout (NULL)", task_join_timeout (&MenosDois, 0, NULL), 0, inicio) ;
+   inicio = systime () ;
+   confere ("mutex_lock_timeout (livre)", mutex_lock_timeout (&m_ocupado, 1000), 0, inicio) ;
+   mutex_unlock (&m_ocupado) ;
+
+   // a chegada que venceu não conta: a barreira ainda precisa de três
+   task_create (&Parceira[0], parceira, NULL) ;
+   task_create (&Parceira[1], parceira, NULL) ;
+   inicio = systime () ;
+   confere ("barrier_join_timeout (3)", barrier_join_timeout (&b_tres, 1000), 0, inicio) ;
+   task_join (&Parceira[0]) ;
+   task_join (&Parceira[1]) ;
+
+   // os prazos atendidos não podem acordar ninguém depois
+   task_sleep (1100) ;
+   printf ("apos os prazos: %d mensagens, sem_down_timeout %d\n", mqueue_msgs (&fila),
+           sem_down_timeout (&s_vazio, 0)) ;
+
+   // muitas esperas vencendo juntas
+   inicio = systime () ;
+   for (i = 0; i < ESPERAS; i++)
+      task_create (&Espera[i], espera, NULL) ;
+   for (i = 0; i < ESPERAS; i++)
+      task_join (&Espera[i]) ;
+   printf ("%d esperas vencidas em %u ms (%d esperadas)\n", vencidas,
+           systime () - inicio, ESPERAS) ;
+   sem_up (&s_muitos) ;
+   confere ("sem_down (sem esperas)", sem_down_timeout (&s_muitos, 0), 0, systime ()) ;
+
+   // destruição antes do prazo
+   task_create (&Destruida, espera, NULL) ;
+   task_sleep (5) ;
+   sem_destroy (&s_muitos) ;
+   task_join (&Destruida) ;
+   task_sleep (50) ;
+   printf ("destruido antes do prazo: %d esperas vencidas (%d esperadas)\n", vencidas, ESPERAS) ;
+
+   task_exit (0) ;
+}
@@ -0,0 +1,144 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Vazão de produtor/consumidor com semáforos: PRODUTORES tarefas produzem
+// ITENS itens num buffer circular de VAGAS posições, consumidos por
+// CONSUMIDORES tarefas. Mede também o caminho sem disputa (sem_down/sem_up em
+// semáforo livre) e confere que sem_destroy libera as tarefas bloqueadas com -1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define PRODUTORES 2
+#define CONSUMIDORES 3
+#define VAGAS 8
+#define ITENS 200000
+#define REPETICOES 1000000
+
+task_t Produtor[PRODUTORES], Consumidor[CONSUMIDORES], Bloqueada ;
+semaphore_t s_vaga, s_item, s_buffer, s_livre, s_destruido ;
+
+int buffer[VAGAS], entrada, saida ;
+long long soma_produzida, soma_consumida ;
+int consumidos[CONSUMIDORES] ;
+
+void produtor (void *arg)
+{
+   long id = (long) arg ;
+   int i, item ;
+
+   for (i = id; i < ITENS; i += PRODUTORES)
+   {
+      item = i + 1 ;
+      sem_down (&s_vaga) ;
+      sem_down (&s_buffer) ;
+      buffer[entrada] = item ;
+      entrada = (entrada + 1) % VAGAS ;
+      soma_produzida += item ;
+      sem_up (&s_buffer) ;
+      sem_up (&s_item) ;
+   }
+   task_exit (0) ;
+}
+
+void consumidor (void *arg)
+{
+   long id = (long) arg ;
+   int item ;
+
+   // o consumidor para ao receber o item 0 (um por consumidor, enviado por main)
+   while (1)
+   {
+      sem_down (&s_item) ;
+      sem_down (&s_buffer) ;
+      item = buffer[saida] ;
+      saida = (saida + 1) % VAGAS ;
+      soma_consumida += item ;
+      sem_up (&s_buffer) ;
+      sem_up (&s_vaga) ;
+
+      if (!item)
+         break ;
+      consumidos[id]++ ;
+   }
+   task_exit (0) ;
+}
+
+void bloqueada (void *arg)
+{
+   int ret = sem_down (&s_destruido) ;
+
+   printf ("bloqueada: sem_down retornou %d apos sem_destroy\n", ret) ;
+   task_exit (ret) ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned int inicio, fim ;
+   long i ;
+
+   ppos_init () ;
+
+   sem_create (&s_vaga, VAGAS) ;
+   sem_create (&s_item, 0) ;
+   sem_create (&s_buffer, 1) ;
+   sem_create (&s_livre, 1) ;
+   sem_create (&s_destruido, 0) ;
+
+   // caminho sem disputa: o semáforo sempre tem unidade disponível
+   inicio = systime () ;
+   for (i = 0; i < REPETICOES; i++)
+   {
+      sem_down (&s_livre) ;
+      sem_up (&s_livre) ;
+   }
+   fim = systime () ;
+   printf ("sem disputa: %d pares down/up em %u ms\n", REPETICOES, fim - inicio) ;
+
+   // produtor/consumidor
+   inicio = systime () ;
+   for (i = 0; i < PRODUTORES; i++)
+      task_create (&Produtor[i], produtor, (void *) i) ;
+   for (i = 0; i < CONSUMIDORES; i++)
+      task_create (&Consumidor[i], consumidor, (void *) i) ;
+
+   for (i = 0; i < PRODUTORES; i++)
+      task_join (&Produtor[i]) ;
+
+   // um item 0 para cada consumidor encerrar
+   for (i = 0; i < CONSUMIDORES; i++)
+   {
+      sem_down (&s_vaga) ;
+      sem_down (&s_buffer) ;
+      buffer[entrada] = 0 ;
+      entrada = (entrada + 1) % VAGAS ;
+      sem_up (&s_buffer) ;
+      sem_up (&s_item) ;
+   }
+   for (i = 0; i < CONSUMIDORES; i++)
+      task_join (&Consumidor[i]) ;
+   fim = systime () ;
+
+   printf ("produtor/consumidor: %d itens em %u ms", ITENS, fim - inicio) ;
+   if (fim > inicio)
+      printf (" (%llu itens/s)", ITENS * 1000ULL / (fim - inicio)) ;
+   printf ("\n") ;
+   for (i = 0; i < CONSUMIDORES; i++)
+      printf ("consumidor %ld: %d itens\n", i, consumidos[i]) ;
+   printf ("soma produzida %lld, consumida %lld: %s\n", soma_produzida,
+           soma_consumida, soma_produzida == soma_consumida ? "ok" : "ERRO") ;
+
+   // destruição com tarefa bloqueada
+   task_create (&Bloqueada, bloqueada, NULL) ;
+   task_sleep (10) ;
+   sem_destroy (&s_destruido) ;
+   task_join (&Bloqueada) ;
+   printf ("sem_down em semaforo destruido: %d\n", sem_down (&s_destruido)) ;
+
+   sem_destroy (&s_vaga) ;
+   sem_destroy (&s_item) ;
+   sem_destroy (&s_buffer) ;
+   sem_destroy (&s_livre) ;
+
+   task_exit (0) ;
+}
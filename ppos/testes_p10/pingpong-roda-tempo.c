@@ -0,0 +1,139 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Roda de tempo: DORMINHOCAS tarefas dormem tempos espalhados de MINIMO a
+// MAXIMO ms (níveis 0 e 1 da roda no modo periódico; nível 2 no tickless,
+// descendo aos níveis 1 e 0 por cascata) e duas esperam um semáforo com prazos
+// de 100 s e 5 horas (níveis 2 e 3 no modo periódico; no tickless, nível 3 e
+// uma espera maior que o alcance da roda, feita em partes). Confere que as
+// dorminhocas acordam em ordem de prazo e nunca antes dele, que task_next_wakeup
+// informa o prazo mais próximo e que as esperas longas saem da roda quando o
+// semáforo as libera. MINIMO dá tempo de todas entrarem na roda antes de a
+// primeira acordar.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define DORMINHOCAS 5000
+#define MINIMO 100                // ms
+#define MAXIMO 2000               // ms
+#define PARTE 1073741             // ms: alcance da roda no modo tickless
+
+task_t Dorminhoca[DORMINHOCAS], Longe[2] ;
+semaphore_t s_longe ;
+unsigned int prazo[DORMINHOCAS], acordou[DORMINHOCAS], prazo_longe[2] ;
+int ordem[DORMINHOCAS], acordadas, dormindo ;
+int espera_longe[2] = {100000, 18000000} ;
+int erros ;
+
+void dorminhoca (void *arg)
+{
+   long i = (long) arg ;
+   int t ;
+
+   // task_sleep lê o relógio de novo: se um tick cair entre as duas leituras, o
+   // prazo real é prazo[i] + 1 (a ordem é conferida pelo prazo guardado na roda)
+   t = MINIMO + (i * 7919) % (MAXIMO - MINIMO) ;
+   prazo[i] = systime () + t ;
+   dormindo++ ;
+   task_sleep (t) ;
+   acordou[i] = systime () ;
+   ordem[acordadas++] = i ;
+   task_exit (0) ;
+}
+
+void longe (void *arg)
+{
+   long i = (long) arg ;
+
+   prazo_longe[i] = systime () + espera_longe[i] ;
+   dormindo++ ;
+   task_exit (sem_down_timeout (&s_longe, espera_longe[i])) ;
+}
+
+// confere o valor de task_next_wakeup, que deve estar entre "minimo" e
+// "minimo + 2": o prazo anotado pela tarefa pode ser 1 ms anterior ao real (a
+// leitura do relógio é outra) e, no modo tickless, um prazo fora do início do ms
+// é arredondado para o ms seguinte. "maximo" amplia a faixa quando necessário.
+void confere_proxima (char *nome, int ret_esperado, unsigned int minimo, unsigned int maximo)
+{
+   unsigned int t = 0 ;
+   int ret, ok ;
+
+   if (maximo < minimo + 2)
+      maximo = minimo + 2 ;
+   ret = task_next_wakeup (&t) ;
+   ok = ret == ret_esperado && (ret != 0 || (t >= minimo && t <= maximo)) ;
+   if (!ok)
+      erros++ ;
+   if (ret == 0)
+      printf ("task_next_wakeup %-22s %s (esperado %u)\n", nome, ok ? "ok" : "ERRO", minimo) ;
+   else
+      printf ("task_next_wakeup %-22s retornou %d (esperado %d)\n", nome, ret,
+              ret_esperado) ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned int inicio, atraso_maximo = 0 ;
+   int i, k, fora_de_ordem = 0, antes_do_prazo = 0 ;
+   long j ;
+
+   ppos_init () ;
+
+   sem_create (&s_longe, 0) ;
+   confere_proxima ("sem tarefas:", -1, 0, 0) ;
+
+   // as dorminhocas e as esperas longas entram na roda
+   inicio = systime () ;
+   for (j = 0; j < DORMINHOCAS; j++)
+      task_create (&Dorminhoca[j], dorminhoca, (void *) j) ;
+   for (j = 0; j < 2; j++)
+      task_create (&Longe[j], longe, (void *) j) ;
+   while (dormindo < DORMINHOCAS + 2)
+      task_yield () ;
+
+   // a próxima a acordar é a dorminhoca de menor prazo na roda (as esperas
+   // longas vencem muito depois)
+   k = 0 ;
+   for (i = 1; i < DORMINHOCAS; i++)
+      if ((int) (Dorminhoca[i].awakening_time - Dorminhoca[k].awakening_time) < 0)
+         k = i ;
+   confere_proxima ("com todas:", 0, prazo[k], 0) ;
+
+   for (i = 0; i < DORMINHOCAS; i++)
+      task_join (&Dorminhoca[i]) ;
+
+   for (i = 0; i < DORMINHOCAS; i++)
+   {
+      if (i > 0 && (int) (Dorminhoca[ordem[i]].awakening_time -
+                          Dorminhoca[ordem[i - 1]].awakening_time) < 0)
+         fora_de_ordem++ ;
+      if (acordou[i] < prazo[i])
+         antes_do_prazo++ ;
+      if (acordou[i] - prazo[i] > atraso_maximo)
+         atraso_maximo = acordou[i] - prazo[i] ;
+   }
+   printf ("%d dorminhocas acordaram em %u ms: %d fora de ordem, %d antes do prazo, atraso maximo %u ms\n",
+           DORMINHOCAS, systime () - inicio, fora_de_ordem, antes_do_prazo, atraso_maximo) ;
+   erros += fora_de_ordem + antes_do_prazo ;
+
+   // só as esperas longas continuam na roda (níveis 2 e 3)
+   confere_proxima ("com as longas:", 0, prazo_longe[0], 0) ;
+   sem_up (&s_longe) ;
+   task_join (&Longe[0]) ;
+
+   // no modo tickless a espera de 5 horas passa do alcance da roda, e
+   // task_next_wakeup informa o fim da parte corrente
+   confere_proxima ("com a de 5 horas:", 0, systime () + PARTE - 2 * MAXIMO, prazo_longe[1] + 2) ;
+   sem_up (&s_longe) ;
+   for (i = 0; i < 2; i++)
+      if (task_join (&Longe[i]) != 0)
+         erros++ ;
+   confere_proxima ("sem adormecidas:", -1, 0, 0) ;
+
+   printf ("%s: %d erros\n", erros ? "ERRO" : "ok", erros) ;
+
+   sem_destroy (&s_longe) ;
+   task_exit (0) ;
+}
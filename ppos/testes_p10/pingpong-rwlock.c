@@ -0,0 +1,176 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Tabela lida e escrita por TAREFAS tarefas, com 90% e 99% de leituras,
+// protegida por um mutex e por uma trava de leitura e escrita. Leituras e
+// escritas cedem o processador no meio (como se fossem preemptadas); cada
+// leitura confere que a tabela não está pela metade. Mostra a vazão de
+// leituras, a maior espera de um escritor e a de um leitor. Ao final, confere
+// o prazo de um escritor (que libera os leitores presos atrás dele) e a
+// destruição da trava.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define TAREFAS 8
+#define OPERACOES 50000           // por tarefa
+#define TAMANHO 64
+#define LONGA 8                   // uma leitura em LONGA cede o processador
+
+task_t Tarefa[TAREFAS], Leitora, Presa ;
+mutex_t m_tabela ;
+rwlock_t l_tabela, l_prazo, l_destruida ;
+int tabela[TAMANHO] ;
+int exclusiva, leituras ;
+long long lidas ;
+unsigned int espera_escritor, espera_leitor ;
+int erros ;
+
+void le (int n)
+{
+   unsigned int inicio = systime () ;
+   int i ;
+
+   if (exclusiva)
+      mutex_lock (&m_tabela) ;
+   else
+      rwlock_rdlock (&l_tabela) ;
+   if (systime () - inicio > espera_leitor)
+      espera_leitor = systime () - inicio ;
+
+   for (i = 1; i < TAMANHO; i++)
+   {
+      if (tabela[i] != tabela[0])
+         erros++ ;
+      if (i == TAMANHO / 2 && n % LONGA == 0)
+         task_yield () ;
+   }
+   lidas++ ;
+
+   if (exclusiva)
+      mutex_unlock (&m_tabela) ;
+   else
+      rwlock_unlock (&l_tabela) ;
+}
+
+void escreve (int valor)
+{
+   unsigned int inicio = systime () ;
+   int i ;
+
+   if (exclusiva)
+      mutex_lock (&m_tabela) ;
+   else
+      rwlock_wrlock (&l_tabela) ;
+   if (systime () - inicio > espera_escritor)
+      espera_escritor = systime () - inicio ;
+
+   for (i = 0; i < TAMANHO; i++)
+   {
+      tabela[i] = valor ;
+      if (i == TAMANHO / 2)
+         task_yield () ;
+   }
+
+   if (exclusiva)
+      mutex_unlock (&m_tabela) ;
+   else
+      rwlock_unlock (&l_tabela) ;
+}
+
+void tarefa (void *arg)
+{
+   unsigned int semente = (long) arg ;
+   int i ;
+
+   for (i = 0; i < OPERACOES; i++)
+   {
+      semente = semente * 1103515245 + 12345 ;
+      if ((semente >> 16) % 100 < leituras)
+         le (i) ;
+      else
+         escreve (i) ;
+   }
+   task_exit (0) ;
+}
+
+void rodada (char *nome)
+{
+   unsigned int inicio, fim ;
+   long i ;
+
+   lidas = 0 ;
+   espera_escritor = espera_leitor = 0 ;
+   inicio = systime () ;
+
+   for (i = 0; i < TAREFAS; i++)
+      task_create (&Tarefa[i], tarefa, (void *) (i + 1)) ;
+   for (i = 0; i < TAREFAS; i++)
+      task_join (&Tarefa[i]) ;
+   fim = systime () ;
+
+   printf ("%2d%% leituras, %-6s %4u ms, %5lld leituras/ms, espera maxima: escritor %3u ms, leitor %3u ms\n",
+           leituras, nome, fim - inicio, lidas / (fim - inicio ? fim - inicio : 1),
+           espera_escritor, espera_leitor) ;
+}
+
+void leitora (void *arg)
+{
+   int result = rwlock_rdlock (&l_prazo) ;
+
+   rwlock_unlock (&l_prazo) ;
+   task_exit (result) ;
+}
+
+void presa (void *arg)
+{
+   task_exit (rwlock_wrlock (&l_destruida)) ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned int inicio ;
+   int result ;
+
+   ppos_init () ;
+
+   mutex_create (&m_tabela) ;
+   rwlock_create (&l_tabela) ;
+   rwlock_create (&l_prazo) ;
+   rwlock_create (&l_destruida) ;
+
+   leituras = 90 ;
+   exclusiva = 1 ;
+   rodada ("mutex") ;
+   exclusiva = 0 ;
+   rodada ("rwlock") ;
+
+   leituras = 99 ;
+   exclusiva = 1 ;
+   rodada ("mutex") ;
+   exclusiva = 0 ;
+   rodada ("rwlock") ;
+
+   printf ("leituras pela metade: %d\n", erros) ;
+
+   // main lê; o escritor espera com prazo e a leitora fica atrás dele
+   rwlock_rdlock (&l_prazo) ;
+   task_create (&Leitora, leitora, NULL) ;
+   inicio = systime () ;
+   result = rwlock_wrlock_timeout (&l_prazo, 30) ;
+   printf ("rwlock_wrlock_timeout retornou %d apos %u ms: %s\n", result,
+           systime () - inicio, result == -2 ? "ok" : "ERRO") ;
+   printf ("leitora atras do escritor: rwlock_rdlock retornou %d\n", task_join (&Leitora)) ;
+   rwlock_unlock (&l_prazo) ;
+
+   rwlock_rdlock (&l_destruida) ;
+   task_create (&Presa, presa, NULL) ;
+   task_sleep (10) ;
+   rwlock_destroy (&l_destruida) ;
+   printf ("trava destruida: rwlock_wrlock retornou %d\n", task_join (&Presa)) ;
+
+   rwlock_destroy (&l_tabela) ;
+   rwlock_destroy (&l_prazo) ;
+   mutex_destroy (&m_tabela) ;
+   task_exit (0) ;
+}
@@ -0,0 +1,133 @@
+// PingPongOS - PingPong Operating System
+// Giovani G. Marciniak GRR20182981, DINF UFPR
+// Sinais do temporizador e latência das esperas: conta os SIGALRM recebidos
+// com uma tarefa ocupada sozinha por DURACAO ms (nenhum no modo tickless, um
+// por ms no periódico) e com duas (um por quantum no modo tickless). Depois uma
+// tarefa dorme SONECAS vezes com task_sleep e com task_usleep, com o sistema
+// ocioso, e mostra o atraso de cada uma; nenhuma pode acordar antes do prazo.
+// Atrasos de 1 ms ou mais vêm do sistema hospedeiro (o sinal chega atrasado) e
+// são mostrados, mas não contam como erro.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include "ppos.h"
+
+#define DURACAO 300               // ms
+#define SONECAS 200
+
+task_t Ocupada, Dorminhoca ;
+void (*tratador_ppos) (int) ;
+volatile int sinais, fim ;
+int tickless, erros ;
+
+// conta o sinal e o repassa ao tratador do núcleo
+void conta_sinal (int signum)
+{
+   sinais++ ;
+   tratador_ppos (signum) ;
+}
+
+// relógio do teste, em micro-segundos
+long long relogio_us ()
+{
+   struct timespec t ;
+
+   clock_gettime (CLOCK_MONOTONIC, &t) ;
+   return t.tv_sec * 1000000LL + t.tv_nsec / 1000 ;
+}
+
+void ocupada (void *arg)
+{
+   while (!fim) ;
+   task_exit (0) ;
+}
+
+void dorminhoca (void *arg)
+{
+   long long antes, atraso, total = 0, maximo = 0 ;
+   int i, t, dormiu, antes_do_prazo = 0, atrasadas = 0 ;
+
+   // task_sleep acorda no início do milissegundo systime () + t
+   for (i = 0; i < SONECAS; i++)
+   {
+      t = 1 + (i * 37) % 50 ;
+      antes = systime () ;
+      task_sleep (t) ;
+      dormiu = systime () - antes ;
+      if (dormiu < t)
+         antes_do_prazo++ ;
+      else if (dormiu > t)
+         atrasadas++ ;
+   }
+   printf ("task_sleep:  %d sonecas, %d antes do prazo (%s), %d acordaram num ms seguinte\n",
+           SONECAS, antes_do_prazo, antes_do_prazo ? "ERRO" : "ok", atrasadas) ;
+   erros += antes_do_prazo ;
+
+   // task_usleep: atraso medido em micro-segundos; no modo periódico a espera
+   // é arredondada para ticks de 1 ms, contados a partir do tick corrente
+   antes_do_prazo = atrasadas = 0 ;
+   for (i = 0; i < SONECAS; i++)
+   {
+      t = 100 + (i * 997) % 5000 ;
+      antes = relogio_us () ;
+      task_usleep (t) ;
+      atraso = relogio_us () - antes - t ;
+      if (atraso < 0)
+         antes_do_prazo++ ;
+      else
+      {
+         total += atraso ;
+         if (atraso > maximo)
+            maximo = atraso ;
+         if (atraso >= 1000)
+            atrasadas++ ;
+      }
+   }
+   printf ("task_usleep: %d sonecas, %d antes do prazo (%s), atraso medio %lld us, maximo %lld us, %d de 1 ms ou mais\n",
+           SONECAS, antes_do_prazo, !tickless ? "-" : antes_do_prazo ? "ERRO" : "ok",
+           total / (SONECAS - antes_do_prazo ? SONECAS - antes_do_prazo : 1), maximo, atrasadas) ;
+   if (tickless)
+      erros += antes_do_prazo ;
+
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   struct sigaction acao ;
+   unsigned int inicio ;
+
+   ppos_init () ;
+
+   // intercepta o SIGALRM do núcleo
+   sigaction (SIGALRM, NULL, &acao) ;
+   tratador_ppos = acao.sa_handler ;
+   acao.sa_handler = conta_sinal ;
+   sigaction (SIGALRM, &acao, NULL) ;
+
+   // main sozinha: no modo tickless não há quantum a vencer
+   sinais = 0 ;
+   inicio = systime () ;
+   while (systime () - inicio < DURACAO) ;
+   printf ("uma tarefa ocupada por %d ms: %d sinais\n", DURACAO, sinais) ;
+   tickless = (sinais == 0) ;
+
+   // main e Ocupada disputam o processador
+   sinais = 0 ;
+   fim = 0 ;
+   task_create (&Ocupada, ocupada, NULL) ;
+   inicio = systime () ;
+   while (systime () - inicio < DURACAO) ;
+   fim = 1 ;
+   printf ("duas tarefas ocupadas por %d ms: %d sinais\n", DURACAO, sinais) ;
+   task_join (&Ocupada) ;
+
+   // só a dorminhoca, com o sistema ocioso entre as sonecas
+   task_create (&Dorminhoca, dorminhoca, NULL) ;
+   task_join (&Dorminhoca) ;
+
+   printf ("%s: %d erros\n", erros ? "ERRO" : "ok", erros) ;
+   task_exit (0) ;
+}